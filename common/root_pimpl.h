@@ -0,0 +1,71 @@
+// Copyright (c) 2024 Huawei Technologies Co. All rights reserved.
+// Use of this source code is governed by an MIT license
+// that can be found in the LICENSE file.
+
+#ifndef ELFIN_PARSE_COMMON_ROOT_PIMPL_H
+#define ELFIN_PARSE_COMMON_ROOT_PIMPL_H
+
+
+#include <memory>
+
+namespace elfin {
+/**
+ * The implementation pointer of a root object such as an ELF or
+ * DWARF file.  A handle either owns the implementation, like the
+ * handles users create, or borrows it, like the back-references held
+ * by sections and units.  A borrowed handle is a plain pointer: it
+ * costs no atomic operations to copy or dereference, and it is valid
+ * exactly as long as some owning handle keeps the root alive.
+ */
+template<typename IMPLT>
+class RootPImpl{
+public:
+    RootPImpl() = default;
+    RootPImpl(const std::shared_ptr<IMPLT> &impl):mShared(impl), mPtr(impl.get()){}
+
+    bool IsOwner() const
+    {
+        return mShared != nullptr;
+    }
+
+    const std::shared_ptr<IMPLT> &GetShared() const
+    {
+        return mShared;
+    }
+
+    IMPLT &Get() const
+    {
+        return *mPtr;
+    }
+
+    operator bool() const
+    {
+        return mPtr != nullptr;
+    }
+
+    bool operator==(const RootPImpl &o) const
+    {
+        return mPtr == o.mPtr;
+    }
+
+    bool operator!=(const RootPImpl &o) const
+    {
+        return mPtr != o.mPtr;
+    }
+
+    /**
+     * Drop ownership, leaving a borrowed handle to the same
+     * implementation.
+     */
+    void ToBorrowed()
+    {
+        mShared.reset();
+    }
+
+private:
+    std::shared_ptr<IMPLT> mShared;
+    IMPLT *mPtr = nullptr;
+};
+}
+
+#endif /*ELFIN_PARSE_COMMON_ROOT_PIMPL_H*/
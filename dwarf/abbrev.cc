@@ -18,6 +18,7 @@ resolve_type(DW_AT name, DW_FORM form)
         case DW_FORM::addrx2:
         case DW_FORM::addrx3:
         case DW_FORM::addrx4:
+        case DW_FORM::GNU_addr_index:
                 return value::type::address;
 
         case DW_FORM::block:
@@ -106,17 +107,18 @@ resolve_type(DW_AT name, DW_FORM form)
         case DW_FORM::ref_udata:
         case DW_FORM::ref_sup4:
         case DW_FORM::ref_sup8:
-        case DW_FORM::strx:
         case DW_FORM::strp_sup:
+                return value::type::reference;
+
+        case DW_FORM::string:
+        case DW_FORM::strp:
         case DW_FORM::line_strp:
+        case DW_FORM::strx:
         case DW_FORM::strx1:
         case DW_FORM::strx2:
         case DW_FORM::strx3:
         case DW_FORM::strx4:
-                return value::type::reference;
-
-        case DW_FORM::string:
-        case DW_FORM::strp:
+        case DW_FORM::GNU_str_index:
                 return value::type::string;
 
         case DW_FORM::indirect:
@@ -125,6 +127,12 @@ resolve_type(DW_AT name, DW_FORM form)
 
         case DW_FORM::sec_offset:
         sec_offset:
+                // The GNU split DWARF bases are in the vendor range
+                // below, so pick them out first
+                if (name == DW_AT::GNU_addr_base ||
+                    name == DW_AT::GNU_ranges_base)
+                        return value::type::constant;
+
                 // The type of this form depends on the attribute
                 switch (name) {
                 case DW_AT::stmt_list:
@@ -141,13 +149,24 @@ resolve_type(DW_AT name, DW_FORM form)
                 case DW_AT::vtable_elem_location:
                         return value::type::loclist;
 
+                case DW_AT::loclists_base:
+                        return value::type::loclist;
+
                 case DW_AT::macro_info:
+                case DW_AT::macros:
                         return value::type::mac;
 
                 case DW_AT::start_scope:
                 case DW_AT::ranges:
+                case DW_AT::rnglists_base:
                         return value::type::rangelist;
 
+                case DW_AT::str_offsets_base:
+                case DW_AT::addr_base:
+                        // Bases for the indexed forms, which are
+                        // only meaningful as numbers
+                        return value::type::constant;
+
                 case DW_AT::lo_user...DW_AT::hi_user:
                         //HACK: ignore vendor extensions
                         return value::type::invalid;
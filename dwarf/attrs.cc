@@ -50,11 +50,15 @@ DWARFPP_BEGIN_NAMESPACE
         }                                               \
         static_assert(true, "")
 
-#define AT_STRING(name)                                 \
-        string at_##name(const die &d)                  \
-        {                                               \
-                return d[DW_AT::name].as_string();      \
-        }                                               \
+#define AT_STRING(name)                                         \
+        string at_##name(const die &d)                          \
+        {                                                       \
+                return d[DW_AT::name].as_string();              \
+        }                                                       \
+        string_view at_##name##_view(const die &d)              \
+        {                                                       \
+                return d[DW_AT::name].as_string_view();         \
+        }                                                       \
         static_assert(true, "")
 
 #define AT_UDYNAMIC(name)                                       \
@@ -0,0 +1,691 @@
+// Copyright (c) 2026 Huawei Technologies Co. All rights reserved.
+// Use of this source code is governed by an MIT license
+// that can be found in the LICENSE file.
+
+#include "internal.hh"
+#include "small_vector.hh"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+
+using namespace std;
+
+DWARFPP_BEGIN_NAMESPACE
+
+// .eh_frame pointer encodings (LSB 5.0 section 10.5.1).  The low
+// four bits give the value format and the next three bits say what
+// the value is relative to.
+enum eh_pe : ubyte
+{
+        eh_pe_absptr   = 0x00,
+        eh_pe_uleb128  = 0x01,
+        eh_pe_udata2   = 0x02,
+        eh_pe_udata4   = 0x03,
+        eh_pe_udata8   = 0x04,
+        eh_pe_sleb128  = 0x09,
+        eh_pe_sdata2   = 0x0a,
+        eh_pe_sdata4   = 0x0b,
+        eh_pe_sdata8   = 0x0c,
+
+        eh_pe_pcrel    = 0x10,
+        eh_pe_indirect = 0x80,
+        eh_pe_omit     = 0xff,
+};
+
+/**
+ * A parsed Common Information Entry.
+ */
+struct cie
+{
+        bool valid;
+        uint64_t code_align;
+        int64_t data_align;
+        uint64_t ra_reg;
+        // Pointer encoding of FDE addresses
+        ubyte fde_enc;
+        // True if FDEs using this CIE have augmentation data
+        bool augmented;
+        // The initial instructions
+        std::shared_ptr<section> insns;
+};
+
+/**
+ * The rules tracked while running a call frame program.
+ */
+struct frame_state
+{
+        unwind_rule cfa, ra, fp;
+};
+
+/**
+ * The rows produced by a single FDE, which covers [low, high).
+ */
+struct fde_rows
+{
+        taddr low, high;
+        vector<unwind_row> rows;
+};
+
+/**
+ * The header of a CIE or FDE.
+ */
+struct cfi_entry
+{
+        // Offset of the CIE id or CIE pointer field and of the end of
+        // this entry
+        section_offset id_pos, end;
+        uint64_t id;
+        bool dwarf64;
+};
+
+static bool
+same_rule(const unwind_rule &a, const unwind_rule &b)
+{
+        return a.type == b.type && a.reg == b.reg && a.offset == b.offset;
+}
+
+static bool
+same_rules(const unwind_row &row, const frame_state &s)
+{
+        return same_rule(row.cfa, s.cfa) && same_rule(row.ra, s.ra) &&
+                same_rule(row.fp, s.fp);
+}
+
+/**
+ * Skip a ULEB128 length followed by that many bytes.
+ */
+static void
+skip_block(cursor &cur)
+{
+        uint64_t len = cur.uleb128();
+        if (len)
+                cur.ensure(len);
+        cur += len;
+}
+
+/**
+ * Return a rule of the given type.  Rules whose operands do not fit
+ * in an unwind_rule become expression rules.
+ */
+static unwind_rule
+make_rule(unwind_rule_type type, uint64_t reg = 0, int64_t offset = 0)
+{
+        unwind_rule r = {type, 0, 0, 0};
+        if (reg > numeric_limits<uhalf>::max() ||
+            offset < numeric_limits<int32_t>::min() ||
+            offset > numeric_limits<int32_t>::max()) {
+                r.type = unwind_rule_type::expression;
+                return r;
+        }
+        r.reg = reg;
+        r.offset = offset;
+        return r;
+}
+
+/**
+ * A parser for one .eh_frame or .debug_frame section.
+ */
+class cfi_parser
+{
+public:
+        cfi_parser(const cfi_data &cfi, bool eh, const void *data,
+                   size_t size, taddr addr)
+                : cfi(cfi), eh(eh),
+                  sec(make_shared<section>(
+                              section_type::frame, data, size,
+                              cfi.msb ? byte_order::msb : byte_order::lsb,
+                              format::unknown, cfi.addr_size)),
+                  sec_addr(addr) { }
+
+        /**
+         * Run every FDE in the section and append its rows to out.
+         * FDEs that cannot be parsed are skipped.
+         */
+        void parse(vector<fde_rows> *out);
+
+private:
+        const cfi_data &cfi;
+        const bool eh;
+        const std::shared_ptr<section> sec;
+        const taddr sec_addr;
+        unordered_map<section_offset, cie> cies;
+
+        bool read_entry(section_offset off, cfi_entry *out);
+        bool is_cie(const cfi_entry &ent) const;
+        const cie &get_cie(section_offset off);
+        void read_cie(section_offset off, cie *out);
+        void read_fde(const cfi_entry &ent, vector<fde_rows> *out);
+        taddr read_encoded(cursor &cur, ubyte enc);
+        unwind_rule *rule_for(frame_state *s, const cie &c, uint64_t reg);
+        void run(const cie &c, const std::shared_ptr<section> &insns,
+                 taddr loc, taddr high, frame_state *state,
+                 const frame_state *initial, vector<unwind_row> *rows);
+        void emit(vector<unwind_row> *rows, taddr pc, taddr high,
+                  const frame_state &s);
+};
+
+void
+cfi_parser::parse(vector<fde_rows> *out)
+{
+        section_offset off = 0;
+        cfi_entry ent;
+        while (off < sec->size() && read_entry(off, &ent)) {
+                off = ent.end;
+                if (is_cie(ent))
+                        continue;
+                try {
+                        read_fde(ent, out);
+                } catch (runtime_error &e) {
+                        // Skip this FDE
+                }
+        }
+}
+
+bool
+cfi_parser::read_entry(section_offset off, cfi_entry *out)
+{
+        // DWARF4 section 7.2.2
+        cursor cur(sec, off);
+        uint64_t length = cur.fixed<uword>();
+        out->dwarf64 = false;
+        if (length == 0xffffffff) {
+                length = cur.fixed<uint64_t>();
+                out->dwarf64 = true;
+        } else if (length >= 0xfffffff0) {
+                throw format_error("initial length has reserved value");
+        }
+        if (length == 0) {
+                // A zero terminator ends .eh_frame.  In .debug_frame,
+                // treat it as padding.
+                if (eh)
+                        return false;
+                out->id_pos = out->end = cur.get_section_offset();
+                out->id = 0;
+                return true;
+        }
+        cur.ensure(length);
+        out->id_pos = cur.get_section_offset();
+        out->end = out->id_pos + length;
+        out->id = out->dwarf64 ? cur.fixed<uint64_t>() : cur.fixed<uword>();
+        return true;
+}
+
+bool
+cfi_parser::is_cie(const cfi_entry &ent) const
+{
+        if (ent.end == ent.id_pos)
+                // Padding
+                return true;
+        if (eh)
+                return ent.id == 0;
+        return ent.id == (ent.dwarf64 ? ~(uint64_t)0 : 0xffffffff);
+}
+
+const cie &
+cfi_parser::get_cie(section_offset off)
+{
+        auto it = cies.find(off);
+        if (it == cies.end()) {
+                cie &c = cies[off];
+                c.valid = false;
+                read_cie(off, &c);
+                c.valid = true;
+                return c;
+        }
+        if (!it->second.valid)
+                throw format_error("bad CIE at offset 0x" + to_hex(off));
+        return it->second;
+}
+
+void
+cfi_parser::read_cie(section_offset off, cie *out)
+{
+        // DWARF4 section 6.4.1 and LSB 5.0 section 10.6.1.1
+        cfi_entry ent;
+        if (!read_entry(off, &ent) || !is_cie(ent) || ent.end == ent.id_pos)
+                throw format_error("CIE pointer does not point to a CIE");
+        cursor cur(sec, ent.id_pos + (ent.dwarf64 ? 8 : 4));
+        ubyte version = cur.fixed<ubyte>();
+        if (version != 1 && version != 3 && version != 4)
+                throw format_error("unknown CIE version " + std::to_string(version));
+        const char *aug = cur.cstr();
+        unsigned addr_size = cfi.addr_size;
+        if (version == 4) {
+                addr_size = cur.fixed<ubyte>();
+                if (cur.fixed<ubyte>() != 0)
+                        throw format_error("segmented addresses are not supported");
+        }
+        out->code_align = cur.uleb128();
+        out->data_align = cur.sleb128();
+        out->ra_reg = version == 1 ? cur.fixed<ubyte>() : cur.uleb128();
+        out->fde_enc = eh_pe_absptr;
+        out->augmented = false;
+
+        if (aug[0] == 'z') {
+                out->augmented = true;
+                uint64_t len = cur.uleb128();
+                if (len)
+                        cur.ensure(len);
+                const char *aug_end = cur.pos + len;
+                for (const char *p = aug + 1; *p; p++) {
+                        switch (*p) {
+                        case 'R':
+                                out->fde_enc = cur.fixed<ubyte>();
+                                break;
+                        case 'P':
+                                // We only need to skip the personality
+                                // routine, so don't follow indirection.
+                                read_encoded(cur, cur.fixed<ubyte>() & ~eh_pe_indirect);
+                                break;
+                        case 'L':
+                                cur.fixed<ubyte>();
+                                break;
+                        case 'S':
+                        case 'B':
+                        case 'G':
+                                break;
+                        default:
+                                throw format_error(std::string("unknown CIE augmentation ") + aug);
+                        }
+                }
+                cur.pos = aug_end;
+        } else if (aug[0] != '\0') {
+                throw format_error(std::string("unknown CIE augmentation ") + aug);
+        }
+
+        out->insns = make_shared<section>(sec->type, cur.pos,
+                                          ent.end - cur.get_section_offset(),
+                                          sec->ord, format::unknown,
+                                          addr_size);
+}
+
+void
+cfi_parser::read_fde(const cfi_entry &ent, vector<fde_rows> *out)
+{
+        // DWARF4 section 6.4.1 and LSB 5.0 section 10.6.1.2.  In
+        // .eh_frame, the CIE pointer is relative to its own location.
+        section_offset cie_off = eh ? ent.id_pos - ent.id : ent.id;
+        const cie &c = get_cie(cie_off);
+
+        cursor cur(sec, ent.id_pos + (ent.dwarf64 ? 8 : 4));
+        ubyte enc = eh ? c.fde_enc : eh_pe_absptr;
+        if (enc == eh_pe_omit || (enc & eh_pe_indirect))
+                throw format_error("unsupported FDE address encoding");
+        fde_rows fr;
+        fr.low = read_encoded(cur, enc);
+        // The address range uses only the value format.
+        fr.high = fr.low + read_encoded(cur, enc & 0x0f);
+        if (c.augmented)
+                skip_block(cur);
+        if (fr.high <= fr.low)
+                return;
+        if (cur.get_section_offset() > ent.end)
+                throw format_error("FDE header exceeds FDE length");
+
+        auto insns = make_shared<section>(sec->type, cur.pos,
+                                          ent.end - cur.get_section_offset(),
+                                          sec->ord, format::unknown,
+                                          c.insns->addr_size);
+
+        // Registers that the CIE doesn't mention have no rule,
+        // except that we assume the frame pointer is callee-saved.
+        frame_state state;
+        state.cfa = state.ra = make_rule(unwind_rule_type::undefined);
+        state.fp = make_rule(cfi.fp_regno == cfi_data::no_register ?
+                             unwind_rule_type::undefined :
+                             unwind_rule_type::same_value);
+        run(c, c.insns, fr.low, fr.high, &state, nullptr, nullptr);
+        frame_state initial = state;
+        run(c, insns, fr.low, fr.high, &state, &initial, &fr.rows);
+        if (fr.rows.empty())
+                emit(&fr.rows, fr.low, fr.high, state);
+        out->push_back(move(fr));
+}
+
+taddr
+cfi_parser::read_encoded(cursor &cur, ubyte enc)
+{
+        if (enc == eh_pe_omit)
+                return 0;
+
+        taddr pc = sec_addr + (cur.pos - sec->begin);
+        taddr val;
+        switch (enc & 0x0f) {
+        case eh_pe_absptr:
+                val = cur.address();
+                break;
+        case eh_pe_uleb128:
+                val = cur.uleb128();
+                break;
+        case eh_pe_udata2:
+                val = cur.fixed<uint16_t>();
+                break;
+        case eh_pe_udata4:
+                val = cur.fixed<uint32_t>();
+                break;
+        case eh_pe_udata8:
+                val = cur.fixed<uint64_t>();
+                break;
+        case eh_pe_sleb128:
+                val = cur.sleb128();
+                break;
+        case eh_pe_sdata2:
+                val = cur.fixed<int16_t>();
+                break;
+        case eh_pe_sdata4:
+                val = cur.fixed<int32_t>();
+                break;
+        case eh_pe_sdata8:
+                val = cur.fixed<int64_t>();
+                break;
+        default:
+                throw format_error("unknown pointer encoding 0x" + to_hex(enc));
+        }
+
+        switch (enc & 0x70) {
+        case 0:
+                break;
+        case eh_pe_pcrel:
+                val += pc;
+                break;
+        default:
+                // XXX textrel and datarel need addresses we don't
+                // have, and are not used by common toolchains.
+                throw format_error("unsupported pointer encoding 0x" + to_hex(enc));
+        }
+
+        if (cfi.addr_size < sizeof(taddr))
+                val &= ((taddr)1 << (8 * cfi.addr_size)) - 1;
+        return val;
+}
+
+unwind_rule *
+cfi_parser::rule_for(frame_state *s, const cie &c, uint64_t reg)
+{
+        if (reg == c.ra_reg)
+                return &s->ra;
+        if (reg == cfi.fp_regno)
+                return &s->fp;
+        return nullptr;
+}
+
+void
+cfi_parser::run(const cie &c, const std::shared_ptr<section> &insns,
+                taddr loc, taddr high, frame_state *state,
+                const frame_state *initial, vector<unwind_row> *rows)
+{
+        // DWARF4 section 6.4.2
+        cursor cur(insns);
+        small_vector<frame_state, 4> remembered;
+        while (!cur.end()) {
+                ubyte op = cur.fixed<ubyte>();
+                uint64_t reg, reg2;
+                int64_t off;
+                unwind_rule *r;
+                taddr next = loc;
+
+                // Opcodes with an operand in the low six bits
+                switch ((DW_CFA)(op & 0xc0)) {
+                case DW_CFA::advance_loc:
+                        next = loc + (op & 0x3f) * c.code_align;
+                        goto advance;
+                case DW_CFA::offset:
+                        reg = op & 0x3f;
+                        off = cur.uleb128() * c.data_align;
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::offset, 0, off);
+                        continue;
+                case DW_CFA::restore:
+                        reg = op & 0x3f;
+                        goto restore;
+                default:
+                        break;
+                }
+
+                switch ((DW_CFA)op) {
+                case DW_CFA::nop:
+                case DW_CFA::GNU_window_save:
+                        break;
+
+                        // 6.4.2.1 Row creation instructions
+                case DW_CFA::set_loc:
+                        next = read_encoded(cur, eh ? (c.fde_enc & ~eh_pe_indirect)
+                                            : eh_pe_absptr);
+                        goto advance;
+                case DW_CFA::advance_loc1:
+                        next = loc + cur.fixed<ubyte>() * c.code_align;
+                        goto advance;
+                case DW_CFA::advance_loc2:
+                        next = loc + cur.fixed<uhalf>() * c.code_align;
+                        goto advance;
+                case DW_CFA::advance_loc4:
+                        next = loc + cur.fixed<uword>() * c.code_align;
+                        goto advance;
+
+                        // 6.4.2.2 CFA definition instructions
+                case DW_CFA::def_cfa:
+                        reg = cur.uleb128();
+                        off = cur.uleb128();
+                        state->cfa = make_rule(unwind_rule_type::reg, reg, off);
+                        break;
+                case DW_CFA::def_cfa_sf:
+                        reg = cur.uleb128();
+                        off = cur.sleb128() * c.data_align;
+                        state->cfa = make_rule(unwind_rule_type::reg, reg, off);
+                        break;
+                case DW_CFA::def_cfa_register:
+                        reg = cur.uleb128();
+                        if (state->cfa.type != unwind_rule_type::expression)
+                                state->cfa = make_rule(unwind_rule_type::reg, reg,
+                                                       state->cfa.offset);
+                        break;
+                case DW_CFA::def_cfa_offset:
+                        off = cur.uleb128();
+                        goto cfa_offset;
+                case DW_CFA::def_cfa_offset_sf:
+                        off = cur.sleb128() * c.data_align;
+                cfa_offset:
+                        if (state->cfa.type == unwind_rule_type::reg)
+                                state->cfa = make_rule(unwind_rule_type::reg,
+                                                       state->cfa.reg, off);
+                        break;
+                case DW_CFA::def_cfa_expression:
+                        skip_block(cur);
+                        state->cfa = make_rule(unwind_rule_type::expression);
+                        break;
+
+                        // 6.4.2.3 Register rule instructions
+                case DW_CFA::undefined:
+                        reg = cur.uleb128();
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::undefined);
+                        break;
+                case DW_CFA::same_value:
+                        reg = cur.uleb128();
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::same_value);
+                        break;
+                case DW_CFA::offset_extended:
+                        reg = cur.uleb128();
+                        off = cur.uleb128() * c.data_align;
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::offset, 0, off);
+                        break;
+                case DW_CFA::offset_extended_sf:
+                        reg = cur.uleb128();
+                        off = cur.sleb128() * c.data_align;
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::offset, 0, off);
+                        break;
+                case DW_CFA::GNU_negative_offset_extended:
+                        reg = cur.uleb128();
+                        off = -(int64_t)cur.uleb128() * c.data_align;
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::offset, 0, off);
+                        break;
+                case DW_CFA::val_offset:
+                        reg = cur.uleb128();
+                        off = cur.uleb128() * c.data_align;
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::val_offset, 0, off);
+                        break;
+                case DW_CFA::val_offset_sf:
+                        reg = cur.uleb128();
+                        off = cur.sleb128() * c.data_align;
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::val_offset, 0, off);
+                        break;
+                case DW_CFA::register_:
+                        reg = cur.uleb128();
+                        reg2 = cur.uleb128();
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::reg, reg2);
+                        break;
+                case DW_CFA::expression:
+                case DW_CFA::val_expression:
+                        reg = cur.uleb128();
+                        skip_block(cur);
+                        if ((r = rule_for(state, c, reg)))
+                                *r = make_rule(unwind_rule_type::expression);
+                        break;
+                case DW_CFA::restore_extended:
+                        reg = cur.uleb128();
+                        goto restore;
+
+                        // 6.4.2.4 Row state instructions
+                case DW_CFA::remember_state:
+                        remembered.push_back(*state);
+                        break;
+                case DW_CFA::restore_state:
+                        if (remembered.empty())
+                                throw format_error("DW_CFA_restore_state without DW_CFA_remember_state");
+                        *state = remembered.back();
+                        remembered.pop_back();
+                        break;
+
+                case DW_CFA::GNU_args_size:
+                        cur.uleb128();
+                        break;
+
+                default:
+                        throw format_error("unknown call frame instruction " +
+                                           to_string((DW_CFA)op));
+                }
+                continue;
+
+        restore:
+                // Restore is meaningless in the CIE's initial
+                // instructions.
+                if (initial && (r = rule_for(state, c, reg)))
+                        *r = *rule_for(const_cast<frame_state*>(initial), c, reg);
+                continue;
+
+        advance:
+                if (rows)
+                        emit(rows, loc, high, *state);
+                loc = next;
+        }
+
+        if (rows)
+                emit(rows, loc, high, *state);
+}
+
+void
+cfi_parser::emit(vector<unwind_row> *rows, taddr pc, taddr high,
+                 const frame_state &s)
+{
+        if (pc >= high)
+                return;
+        if (!rows->empty() && rows->back().pc == pc) {
+                // Several instructions at the same location
+                rows->pop_back();
+        }
+        if (!rows->empty() && same_rules(rows->back(), s))
+                return;
+        rows->push_back(unwind_row{pc, s.cfa, s.ra, s.fp});
+}
+
+//////////////////////////////////////////////////////////////////
+// class unwind_table
+//
+
+unwind_table::unwind_table(const cfi_data &cfi)
+        : owned(make_shared<vector<unwind_row> >())
+{
+        vector<fde_rows> fdes;
+        if (cfi.eh_frame) {
+                cfi_parser p(cfi, true, cfi.eh_frame, cfi.eh_frame_size,
+                             cfi.eh_frame_addr);
+                try {
+                        p.parse(&fdes);
+                } catch (runtime_error &e) {
+                        // Keep whatever we parsed before the section
+                        // became unreadable
+                }
+        }
+        if (cfi.debug_frame) {
+                cfi_parser p(cfi, false, cfi.debug_frame,
+                             cfi.debug_frame_size, 0);
+                try {
+                        p.parse(&fdes);
+                } catch (runtime_error &e) {
+                }
+        }
+
+        // Index the FDEs by address.  .eh_frame FDEs come first in
+        // fdes, so they take precedence over overlapping .debug_frame
+        // FDEs.
+        map<taddr, const fde_rows*> by_addr;
+        for (auto &fde : fdes) {
+                auto it = by_addr.upper_bound(fde.low);
+                if (it != by_addr.end() && it->second->low < fde.high)
+                        continue;
+                if (it != by_addr.begin() && prev(it)->second->high > fde.low)
+                        continue;
+                by_addr.emplace(fde.low, &fde);
+        }
+
+        // Concatenate the rows, marking gaps between FDEs.
+        vector<unwind_row> &rows = *owned;
+        const unwind_rule none = make_rule(unwind_rule_type::undefined);
+        for (auto it = by_addr.begin(); it != by_addr.end(); ++it) {
+                const fde_rows &fde = *it->second;
+                for (auto &row : fde.rows) {
+                        if (!rows.empty() && same_rule(rows.back().cfa, row.cfa) &&
+                            same_rule(rows.back().ra, row.ra) &&
+                            same_rule(rows.back().fp, row.fp))
+                                continue;
+                        rows.push_back(row);
+                }
+                auto next = std::next(it);
+                if (next == by_addr.end() || next->first != fde.high)
+                        rows.push_back(unwind_row{fde.high, none, none, none});
+        }
+
+        rows.shrink_to_fit();
+        base = rows.data();
+        count = rows.size();
+}
+
+unwind_table::unwind_table(const unwind_row *rows, size_t count)
+        : base(rows), count(count)
+{
+}
+
+const unwind_row *
+unwind_table::find(taddr pc) const
+{
+        const unwind_row *end = base + count;
+        const unwind_row *it = upper_bound(
+                base, end, pc,
+                [](taddr pc, const unwind_row &row) { return pc < row.pc; });
+        if (it == base)
+                return nullptr;
+        --it;
+        if (it->cfa.type == unwind_rule_type::undefined)
+                return nullptr;
+        return it;
+}
+
+DWARFPP_END_NAMESPACE
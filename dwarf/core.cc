@@ -0,0 +1,258 @@
+// Copyright (c) 2026 Huawei Technologies Co. All rights reserved.
+// Use of this source code is governed by an MIT license
+// that can be found in the LICENSE file.
+
+#include "internal.hh"
+
+#include <algorithm>
+#include <mutex>
+
+using namespace std;
+
+DWARFPP_BEGIN_NAMESPACE
+
+// ELF e_machine values
+enum
+{
+        em_386     = 3,
+        em_x86_64  = 62,
+        em_aarch64 = 183,
+};
+
+uint64_t
+read_word(const void *data, unsigned size, bool msb)
+{
+        const unsigned char *p = (const unsigned char*)data;
+        uint64_t val = 0;
+        if (msb) {
+                for (unsigned i = 0; i < size; i++)
+                        val = (val << 8) | p[i];
+        } else {
+                for (unsigned i = size; i > 0; i--)
+                        val = (val << 8) | p[i - 1];
+        }
+        return val;
+}
+
+bool
+user_regs_get(unsigned machine, bool msb, const void *regs,
+              size_t size, unsigned regnum, taddr *out)
+{
+        // Indexes of each DWARF register in user_regs_struct.  See
+        // the psABI DWARF register mappings and the kernel's
+        // asm/user.h.
+        static const unsigned char x86_64_regs[] = {
+                10,             // rax
+                12,             // rdx
+                11,             // rcx
+                5,              // rbx
+                13,             // rsi
+                14,             // rdi
+                4,              // rbp
+                19,             // rsp
+                9, 8, 7, 6,     // r8-r11
+                3, 2, 1, 0,     // r12-r15
+                16,             // return address (rip)
+        };
+        static const unsigned char i386_regs[] = {
+                6,              // eax
+                1,              // ecx
+                2,              // edx
+                0,              // ebx
+                15,             // esp
+                5,              // ebp
+                3,              // esi
+                4,              // edi
+                12,             // return address (eip)
+        };
+
+        unsigned index, word;
+        switch (machine) {
+        case em_386:
+                if (regnum >= sizeof(i386_regs))
+                        return false;
+                index = i386_regs[regnum];
+                word = 4;
+                break;
+        case em_x86_64:
+                if (regnum >= sizeof(x86_64_regs))
+                        return false;
+                index = x86_64_regs[regnum];
+                word = 8;
+                break;
+        case em_aarch64:
+                // x0-x30, sp, and pc are in DWARF order
+                if (regnum > 32)
+                        return false;
+                index = regnum;
+                word = 8;
+                break;
+        default:
+                return false;
+        }
+
+        if ((index + 1) * word > size)
+                return false;
+        *out = read_word((const char*)regs + index * word, word, msb);
+        return true;
+}
+
+size_t
+prstatus_regs_offset(unsigned machine)
+{
+        // Following pr_info, pr_cursig, pr_sigpend, pr_sighold, four
+        // pids, and four timevals
+        switch (machine) {
+        case em_386:
+                return 72;
+        case em_x86_64:
+        case em_aarch64:
+                return 112;
+        default:
+                return 0;
+        }
+}
+
+//////////////////////////////////////////////////////////////////
+// class core_context
+//
+
+struct core_context::impl
+{
+        unsigned machine;
+        bool msb;
+        // Sorted by vaddr
+        vector<region> regions;
+        vector<prstatus> threads;
+        shared_ptr<const void> keepalive;
+        // Guards the load of each region's data
+        unique_ptr<once_flag[]> loaded;
+
+        /**
+         * Return the region containing address, or nullptr.
+         */
+        const region *find(taddr address) const
+        {
+                auto it = upper_bound(
+                        regions.begin(), regions.end(), address,
+                        [](taddr a, const region &r) { return a < r.vaddr; });
+                if (it == regions.begin())
+                        return nullptr;
+                --it;
+                if (address - it->vaddr >= it->mem_size)
+                        return nullptr;
+                return &*it;
+        }
+
+        /**
+         * Return the file data of r, which is one of regions,
+         * loading it if this is the first use.
+         */
+        const char *data(const region &r)
+        {
+                if (r.load) {
+                        region &w = regions[&r - regions.data()];
+                        call_once(loaded[&r - regions.data()],
+                                  [&] { w.data = w.load(); });
+                }
+                return (const char*)r.data;
+        }
+};
+
+core_context::core_context(unsigned machine, bool msb,
+                           vector<region> regions, vector<prstatus> threads,
+                           shared_ptr<const void> keepalive)
+        : m(make_shared<impl>())
+{
+        m->machine = machine;
+        m->msb = msb;
+        m->regions = move(regions);
+        m->threads = move(threads);
+        m->keepalive = move(keepalive);
+        m->loaded.reset(new once_flag[m->regions.size()]);
+        sort(m->regions.begin(), m->regions.end(),
+             [](const region &a, const region &b) { return a.vaddr < b.vaddr; });
+}
+
+size_t
+core_context::thread_count() const
+{
+        return m->threads.size();
+}
+
+void
+core_context::select_thread(size_t index)
+{
+        if (index >= m->threads.size())
+                throw out_of_range("thread index out of range");
+        thread = index;
+}
+
+const void *
+core_context::data_at(taddr address, size_t size) const
+{
+        const region *r = m->find(address);
+        if (!r)
+                return nullptr;
+        taddr off = address - r->vaddr;
+        if (off > r->file_size || size > r->file_size - off)
+                return nullptr;
+        return m->data(*r) + off;
+}
+
+bool
+core_context::read(taddr address, void *buf, size_t size) const
+{
+        char *out = (char*)buf;
+        while (size) {
+                const region *r = m->find(address);
+                if (!r)
+                        return false;
+                taddr off = address - r->vaddr;
+                size_t n = min((taddr)size, r->mem_size - off);
+                size_t file_n = 0;
+                if (off < r->file_size)
+                        file_n = min((taddr)n, r->file_size - off);
+                if (file_n)
+                        memcpy(out, m->data(*r) + off, file_n);
+                memset(out + file_n, 0, n - file_n);
+                out += n;
+                address += n;
+                size -= n;
+        }
+        return true;
+}
+
+taddr
+core_context::reg(unsigned regnum)
+{
+        if (m->threads.empty())
+                throw expr_error("core file has no NT_PRSTATUS notes");
+        const prstatus &ps = m->threads[thread];
+        size_t off = prstatus_regs_offset(m->machine);
+        taddr val;
+        if (off == 0 || ps.size < off ||
+            !user_regs_get(m->machine, m->msb, (const char*)ps.data + off,
+                           ps.size - off, regnum, &val))
+                throw expr_error("register " + std::to_string(regnum) +
+                                 " not available in core file");
+        return val;
+}
+
+taddr
+core_context::deref_size(taddr address, unsigned size)
+{
+        if (size > sizeof(taddr))
+                throw expr_error("DW_OP_deref_size operand exceeds address size");
+        const void *p = data_at(address, size);
+        char buf[sizeof(taddr)];
+        if (!p) {
+                if (!read(address, buf, size))
+                        throw expr_error("address 0x" + to_hex(address) +
+                                         " not in core file");
+                p = buf;
+        }
+        return read_word(p, size, m->msb);
+}
+
+DWARFPP_END_NAMESPACE
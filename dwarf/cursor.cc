@@ -95,13 +95,15 @@ cursor::cstr(size_t *size_out)
 {
         // Scan string size
         const char *p = pos;
-        while (pos < sec->end && *pos)
-                pos++;
-        if (pos == sec->end)
+        const char *nul = pos < sec->end ?
+                (const char*)memchr(pos, 0, sec->end - pos) : nullptr;
+        if (!nul) {
+                pos = sec->end;
                 throw format_error("unterminated string");
+        }
         if (size_out)
-                *size_out = pos - p;
-        pos++;
+                *size_out = nul - p;
+        pos = nul + 1;
         return p;
 }
 
@@ -155,6 +157,8 @@ cursor::skip_form(DW_FORM form)
 
                 // fixed-length forms
         case DW_FORM::flag_present:
+        case DW_FORM::implicit_const:
+                // The value is in the abbrev
                 break;
         case DW_FORM::flag:
         case DW_FORM::data1:
@@ -195,9 +199,10 @@ cursor::skip_form(DW_FORM form)
         case DW_FORM::ref_udata:
         case DW_FORM::strx:
         case DW_FORM::addrx:
-        case DW_FORM::implicit_const:
         case DW_FORM::loclistx:
         case DW_FORM::rnglistx:
+        case DW_FORM::GNU_addr_index:
+        case DW_FORM::GNU_str_index:
                 while (pos < sec->end && (*(uint8_t*)pos & 0x80))
                         pos++;
                 pos++;
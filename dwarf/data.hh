@@ -24,6 +24,20 @@ typedef std::uint64_t section_length;
 // represents the largest supported address type.
 typedef std::uint64_t taddr;
 
+// Unit header unit types (DWARF5 section 7.5.1, figure 16)
+enum class DW_UT : ubyte
+{
+        compile       = 0x01,
+        type          = 0x02,
+        partial       = 0x03,
+        skeleton      = 0x04,
+        split_compile = 0x05,
+        split_type    = 0x06,
+};
+
+std::string
+to_string(DW_UT v);
+
 // DIE tags (Section 7, figure 18).  typedef, friend, and namespace
 // have a trailing underscore because they are reserved words.
 enum class DW_TAG
@@ -91,6 +105,17 @@ enum class DW_TAG
         type_unit                = 0x41,
         rvalue_reference_type    = 0x42,
         template_alias           = 0x43,
+
+        // DWARF 5
+        coarray_type             = 0x44,
+        generic_subrange         = 0x45,
+        dynamic_type             = 0x46,
+        atomic_type              = 0x47,
+        call_site                = 0x48,
+        call_site_parameter      = 0x49,
+        skeleton_unit            = 0x4a,
+        immutable_type           = 0x4b,
+
         lo_user                  = 0x4080,
         hi_user                  = 0xffff,
 };
@@ -213,7 +238,45 @@ enum class DW_AT
         enum_class           = 0x6d, // flag
         linkage_name         = 0x6e, // string
 
+        // DWARF 5
+        string_length_bit_size  = 0x6f, // constant
+        string_length_byte_size = 0x70, // constant
+        rank                 = 0x71, // constant, exprloc
+        str_offsets_base     = 0x72, // stroffsetsptr
+        addr_base            = 0x73, // addrptr
+        rnglists_base        = 0x74, // rnglistsptr
+        dwo_name             = 0x76, // string
+        reference            = 0x77, // flag
+        rvalue_reference     = 0x78, // flag
+        macros               = 0x79, // macptr
+        call_all_calls       = 0x7a, // flag
+        call_all_source_calls = 0x7b, // flag
+        call_all_tail_calls  = 0x7c, // flag
+        call_return_pc       = 0x7d, // address
+        call_value           = 0x7e, // exprloc
+        call_origin          = 0x7f, // exprloc
+        call_parameter       = 0x80, // reference
+        call_pc              = 0x81, // address
+        call_tail_call       = 0x82, // flag
+        call_target          = 0x83, // exprloc
+        call_target_clobbered = 0x84, // exprloc
+        call_data_location   = 0x85, // exprloc
+        call_data_value      = 0x86, // exprloc
+        noreturn             = 0x87, // flag
+        alignment            = 0x88, // constant
+        export_symbols       = 0x89, // flag
+        deleted              = 0x8a, // flag
+        defaulted            = 0x8b, // constant
+        loclists_base        = 0x8c, // loclistsptr
+
         lo_user              = 0x2000,
+
+        // GNU split DWARF extensions for DWARF 4
+        GNU_dwo_name         = 0x2130, // string
+        GNU_dwo_id           = 0x2131, // constant
+        GNU_ranges_base      = 0x2132, // rangelistptr
+        GNU_addr_base        = 0x2133, // addrptr
+
         hi_user              = 0x3fff,
 };
 
@@ -271,6 +334,10 @@ enum class DW_FORM
         addrx2 = 0x2a, // address
         addrx3 = 0x2b, // address
         addrx4 = 0x2c, // address
+
+        // GNU split DWARF extensions for DWARF 4
+        GNU_addr_index = 0x1f01, // address
+        GNU_str_index = 0x1f02, // string
 };
 
 std::string
@@ -595,6 +662,53 @@ enum class DW_LNCT
 std::string
 to_string(DW_LNCT v);
 
+// Call frame instruction encodings (DWARF4 section 7.23 figure 40).
+// advance_loc, offset, and restore are encoded in the high two bits
+// of the opcode, with their first operand in the low six bits.
+enum class DW_CFA : ubyte
+{
+        advance_loc        = 0x40, // [delta]
+        offset             = 0x80, // [register, ULEB128 offset]
+        restore            = 0xc0, // [register]
+
+        nop                = 0x00,
+        set_loc            = 0x01, // [address]
+        advance_loc1       = 0x02, // [1-byte delta]
+        advance_loc2       = 0x03, // [2-byte delta]
+        advance_loc4       = 0x04, // [4-byte delta]
+        offset_extended    = 0x05, // [ULEB128 register, ULEB128 offset]
+        restore_extended   = 0x06, // [ULEB128 register]
+        undefined          = 0x07, // [ULEB128 register]
+        same_value         = 0x08, // [ULEB128 register]
+        register_          = 0x09, // [ULEB128 register, ULEB128 register]
+        remember_state     = 0x0a,
+        restore_state      = 0x0b,
+        def_cfa            = 0x0c, // [ULEB128 register, ULEB128 offset]
+        def_cfa_register   = 0x0d, // [ULEB128 register]
+        def_cfa_offset     = 0x0e, // [ULEB128 offset]
+
+        // DWARF 3
+        def_cfa_expression = 0x0f, // [BLOCK]
+        expression         = 0x10, // [ULEB128 register, BLOCK]
+        offset_extended_sf = 0x11, // [ULEB128 register, SLEB128 offset]
+        def_cfa_sf         = 0x12, // [ULEB128 register, SLEB128 offset]
+        def_cfa_offset_sf  = 0x13, // [SLEB128 offset]
+        val_offset         = 0x14, // [ULEB128, ULEB128]
+        val_offset_sf      = 0x15, // [ULEB128, SLEB128]
+        val_expression     = 0x16, // [ULEB128, BLOCK]
+
+        lo_user            = 0x1c,
+        hi_user            = 0x3f,
+
+        // GNU extensions (also AArch64 negate_ra_state)
+        GNU_window_save    = 0x2d,
+        GNU_args_size      = 0x2e, // [ULEB128 size]
+        GNU_negative_offset_extended = 0x2f, // [ULEB128 register, ULEB128 offset]
+};
+
+std::string
+to_string(DW_CFA v);
+
 DWARFPP_END_NAMESPACE
 
 #endif
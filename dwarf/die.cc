@@ -9,7 +9,7 @@ using namespace std;
 DWARFPP_BEGIN_NAMESPACE
 
 die::die(const unit *cu)
-        : cu(cu), abbrev(nullptr)
+        : tag(), cu(cu), abbrev(nullptr), offset(0), next(0)
 {
 }
 
@@ -47,6 +47,12 @@ die::read(section_offset off)
         attrs.clear();
         attrs.reserve(abbrev->attributes.size());
         for (auto &attr : abbrev->attributes) {
+                // An implicit_const attribute has no data in the DIE;
+                // its constant is in the abbrev
+                if (attr.form == DW_FORM::implicit_const) {
+                        attrs.push_back(off);
+                        continue;
+                }
                 attrs.push_back(cur.get_section_offset());
                 cur.skip_form(attr.form);
         }
@@ -74,7 +80,8 @@ die::operator[](DW_AT attr) const
                 int i = 0;
                 for (auto &a : abbrev->attributes) {
                         if (a.name == attr)
-                                return value(cu, a.name, a.form, a.type, attrs[i]);
+                                return value(cu, a.name, a.form, a.type, attrs[i],
+                                             a.val);
                         i++;
                 }
         }
@@ -93,26 +100,28 @@ die::resolve(DW_AT attr) const
         // completed by its abstract instance, so we first try to
         // resolve abstract_origin, then we resolve specification.
 
-        // XXX This traverses the abbrevs at least twice and
-        // potentially several more times
+        // Many DIEs share an abstract origin (consider every inlined
+        // instance of a function), so the referenced unit caches
+        // each origin DIE and its specification rather than reading
+        // them again here.
 
         if (has(attr))
                 return (*this)[attr];
 
-        if (has(DW_AT::abstract_origin)) {
-                die ao = (*this)[DW_AT::abstract_origin].as_reference();
-                if (ao.has(attr))
-                        return ao[attr];
-                if (ao.has(DW_AT::specification)) {
-                        die s = ao[DW_AT::specification].as_reference();
-                        if (s.has(attr))
-                                return s[attr];
-                }
-        } else if (has(DW_AT::specification)) {
-                die s = (*this)[DW_AT::specification].as_reference();
-                if (s.has(attr))
-                        return s[attr];
-        }
+        bool from_ao = has(DW_AT::abstract_origin);
+        if (!from_ao && !has(DW_AT::specification))
+                return value();
+
+        const unit *target;
+        section_offset off;
+        (*this)[from_ao ? DW_AT::abstract_origin : DW_AT::specification]
+                .as_reference_location(&target, &off);
+        die origin, s;
+        target->get_origin(off, &origin, &s);
+        if (origin.has(attr))
+                return origin[attr];
+        if (from_ao && s.valid() && s.has(attr))
+                return s[attr];
 
         return value();
 }
@@ -160,24 +169,16 @@ die::iterator::operator++()
         return *this;
 }
 
-const vector<pair<DW_AT, value> >
-die::attributes() const
+die::attribute_range
+die::attributes() const &
 {
-        vector<pair<DW_AT, value> > res;
+        return attribute_range(this);
+}
 
-        if (!abbrev)
-                return res;
-
-        // XXX Quite slow, especially when using this to traverse an
-        // entire DIE tree since each DIE will produce a new vector
-        // (whereas other vectors get reused).  Might be worth a
-        // custom iterator.
-        int i = 0;
-        for (auto &a : abbrev->attributes) {
-                res.push_back(make_pair(a.name, value(cu, a.name, a.form, a.type, attrs[i])));
-                i++;
-        }
-        return res;
+die::attribute_range
+die::attributes() &&
+{
+        return attribute_range(std::move(*this));
 }
 
 bool
@@ -192,6 +193,48 @@ die::operator!=(const die &o) const
         return !(*this == o);
 }
 
+die::attribute_iterator
+die::attribute_range::begin() const
+{
+        return attribute_iterator(&get(), 0);
+}
+
+die::attribute_iterator
+die::attribute_range::end() const
+{
+        // Iterators are only compared by index
+        attribute_iterator it;
+        auto &d = get();
+        it.index = d.abbrev ? d.abbrev->attributes.size() : 0;
+        return it;
+}
+
+die::attribute_iterator::attribute_iterator(const die *d, unsigned index)
+        : d(d), index(index)
+{
+        decode();
+}
+
+void
+die::attribute_iterator::decode()
+{
+        // die::read already found where each attribute is
+        if (!d->abbrev || index >= d->abbrev->attributes.size())
+                return;
+        auto &spec = d->abbrev->attributes[index];
+        attr.first = spec.name;
+        attr.second = value(d->cu, spec.name, spec.form, spec.type,
+                            d->attrs[index], spec.val);
+}
+
+die::attribute_iterator &
+die::attribute_iterator::operator++()
+{
+        index++;
+        decode();
+        return *this;
+}
+
 DWARFPP_END_NAMESPACE
 
 size_t
@@ -10,17 +10,24 @@
 #define DWARFPP_END_NAMESPACE   }
 #endif
 
-#include "../common/shared_weak.h"
+#include "../common/root_pimpl.h"
 #include "data.hh"
 #include "small_vector.hh"
 
+#include <cstring>
+#include <functional>
+#include <future>
 #include <initializer_list>
 #include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include <sys/types.h>
+
 DWARFPP_BEGIN_NAMESPACE
 
 // Forward declarations
@@ -40,6 +47,7 @@ class line_table;
 struct section;
 struct abbrev_entry;
 struct cursor;
+struct expr_program;
 
 // XXX Audit for binary-compatibility
 
@@ -56,8 +64,9 @@ struct cursor;
 
 // XXX Indicate DWARF4 in all spec references
 
-// XXX Big missing support: .debug_aranges, .debug_frame, loclists,
-// macros
+// XXX Big missing support: .debug_aranges, loclists, macros.
+// .debug_frame and .eh_frame are only supported through
+// unwind_table.
 
 //////////////////////////////////////////////////////////////////
 // DWARF file_list
@@ -94,11 +103,37 @@ enum class section_type
         str,
         types,
         line_str,
+        str_offsets,
+        addr,
+        loclists,
+        rnglists,
+        // Indexes of the units in a DWARF package (.dwp) file
+        cu_index,
+        tu_index,
 };
 
 std::string
 to_string(section_type v);
 
+/**
+ * How a DWARF section is expected to be accessed.  These match the
+ * values of elf::access_pattern.
+ */
+enum class access_pattern
+{
+        // No particular pattern
+        normal,
+        // Read front to back, likely once, as in a full DIE walk
+        sequential,
+        // Scattered small reads, as in address lookups
+        random,
+        // Needed soon; start reading it in now
+        willneed,
+};
+
+std::string
+to_string(access_pattern v);
+
 /**
  * A DWARF file.  This class is internally reference counted and can
  * be efficiently copied.
@@ -106,6 +141,11 @@ to_string(section_type v);
  * Objects retrieved from this object may depend on it; the caller is
  * responsible for keeping this object live as long as any retrieved
  * object may be in use.
+ *
+ * Units fill caches lazily from const methods, such as their
+ * abbrevs, line tables, decoded expressions, and resolved origins,
+ * without locking.  A dwarf object and the objects retrieved from it
+ * must not be used from several threads at once.
  */
 class dwarf
 {
@@ -155,12 +195,31 @@ public:
         const std::vector<compilation_unit> &compilation_units() const;
 
         /**
-         * Return the type unit with the given signature.  If the
-         * signature does not correspond to a type unit, throws
-         * out_of_range.
+         * Return the type unit with the given signature, from
+         * .debug_types, from .debug_info for DWARF 5, or from a DWARF
+         * package's .debug_tu_index.  The first lookup indexes
+         * .debug_types, and each unit is only read when it is first
+         * returned.  If the signature does not correspond to a type
+         * unit, throws out_of_range.
          */
         const type_unit &get_type_unit(uint64_t type_signature) const;
 
+        /**
+         * Return the DIE at the given .debug_info offset, such as
+         * one returned by die::get_section_offset.  This finds the
+         * compilation unit containing offset by binary search.  If
+         * offset is not in any compilation unit, throws
+         * out_of_range.  offset must be the start of a DIE.
+         */
+        die die_at_offset(section_offset offset) const;
+
+        /**
+         * \internal Return the compilation unit containing the DIE
+         * at the given .debug_info offset.  Throws out_of_range like
+         * die_at_offset.
+         */
+        const compilation_unit &unit_at_offset(section_offset offset) const;
+
         /**
          * \internal Retrieve the specified section from this file.
          * If the section does not exist, throws format_error.
@@ -168,16 +227,78 @@ public:
         std::shared_ptr<section> get_section(section_type type) const;
         bool has_section(section_type type) const;
 
-        dwarf get_weak_copy()
+        /**
+         * Hint that the given sections will be needed soon.  With a
+         * loader that reads in the background, such as one backed by
+         * elf::create_async_loader, this lets I/O for these sections
+         * overlap with parsing the sections that are already
+         * loaded.  Sections that are loaded or missing are ignored.
+         */
+        void prefetch(const std::initializer_list<section_type> &types) const;
+
+        /**
+         * Hint how the given section will be accessed from now on,
+         * for example sequential before walking every DIE in
+         * .debug_info or random before answering address queries.
+         * Loaders backed by mmap pass this to madvise.
+         *
+         * The constructor reads every unit header in order, so it
+         * leaves .debug_info sequential, replacing any hint given
+         * earlier through elf::loader::advise; give a different
+         * hint after constructing this object.  Apart from that
+         * and elf::create_unwind_table, which parses whole
+         * sections, the library leaves hints to the caller.  Scans
+         * of a single unit, such as unit::dfs, die_str_map, and
+         * building or iterating over a line_table, read one unit
+         * while the hint covers the whole section, so only the
+         * caller knows whether it will visit every unit.  A caller
+         * that decodes every unit's line table should advise
+         * .debug_line sequential itself, as it would .debug_info
+         * before walking every DIE.
+         */
+        void advise(section_type type, access_pattern pattern) const;
+
+        /**
+         * Search the DWARF package file (.dwp) at path for the split
+         * units of this file's skeleton units before looking for
+         * their .dwo files.  A package is conventionally named after
+         * its binary with ".dwp" appended.  The package is not opened
+         * until a skeleton unit is first resolved.
+         */
+        void set_package_path(const std::string &path);
+
+        /**
+         * \internal Return the split unit with the given DWO ID from
+         * this file's package, or else from the .dwo file at path.
+         * Each file is opened the first time it is needed.  Throws
+         * format_error if neither has the unit.
+         */
+        compilation_unit find_split_unit(uint64_t dwo_id,
+                                         const std::string &path) const;
+
+        /**
+         * \internal Return a handle to this file that does not own
+         * it.  Objects owned by this file use this to refer back to
+         * it without keeping it alive or paying for reference
+         * counting.  The returned handle is only valid while an
+         * owning handle is live.
+         */
+        dwarf get_borrowed_copy() const
         {
-                dwarf weak = *this;
-                weak.m.ToWeak();
-                return weak;
+                dwarf borrowed = *this;
+                borrowed.m.ToBorrowed();
+                return borrowed;
         }
 
 private:
         struct impl;
-        elfin::SharedWeakPImpl<impl> m;
+        elfin::RootPImpl<impl> m;
+
+        /**
+         * Construct a DWARF package file.  Its units are found
+         * through its .debug_cu_index rather than read up front.
+         */
+        dwarf(const std::shared_ptr<loader> &l, bool package);
 };
 
 /**
@@ -191,14 +312,63 @@ public:
         /**
          * Load the requested DWARF section into memory and return a
          * pointer to the beginning of it.  This memory must remain
-         * valid and unchanged until the loader is destroyed.  If the
-         * requested section does not exist, this should return
-         * nullptr.  If the section exists but cannot be loaded for
-         * any reason, this should throw an exception.
+         * valid and unchanged until the loader is destroyed or the
+         * section is released.  If the requested section does not
+         * exist, this should return nullptr.  If the section exists
+         * but cannot be loaded for any reason, this should throw an
+         * exception.
          */
         virtual const void *load(section_type section, size_t *size_out) = 0;
+
+        /**
+         * Release a section returned by load.  The dwarf object
+         * releases each section it loaded when it is destroyed.  The
+         * default does nothing.
+         */
+        virtual void release(section_type section) { }
+
+        /**
+         * Hint that the given section will be loaded soon, so the
+         * loader can start reading it in the background.  The
+         * default does nothing.
+         */
+        virtual void prefetch(section_type section) { }
+
+        /**
+         * Hint how the given section will be accessed from now on.
+         * The default does nothing.
+         */
+        virtual void advise(section_type section, access_pattern pattern) { }
+
+        /**
+         * Return a loader for the split DWARF file at path, which is
+         * a .dwo file or a DWARF package (.dwp), or nullptr if there
+         * is no such file.  The returned loader reads the ".dwo"
+         * sections of that file as the ordinary DWARF sections.  The
+         * default returns nullptr, so skeleton units cannot be
+         * resolved.
+         */
+        virtual std::shared_ptr<loader> open_split(const std::string &path)
+        {
+                return nullptr;
+        }
 };
 
+/**
+ * Create a loader for DWARF sections that are already in memory,
+ * such as DWARF emitted by a JIT without an ELF container.  sections
+ * gives the data and size of each section present.  Nothing is
+ * copied, so the data must stay valid and unchanged while the loader
+ * is live; the loader holds keepalive, if given, to ensure this.  To
+ * read DWARF from an in-memory ELF image instead, use
+ * elf::create_loader with an elf::elf backed by
+ * elf::create_memory_loader.
+ */
+std::shared_ptr<loader>
+create_memory_loader(
+        const std::map<section_type, std::pair<const void*, size_t> > &sections,
+        std::shared_ptr<const void> keepalive = nullptr);
+
 /**
  * The base class for a compilation unit or type unit within a DWARF
  * file.  A unit consists of a rooted tree of DIEs, plus additional
@@ -246,6 +416,27 @@ public:
          */
         const die &root() const;
 
+        class dfs_iterator;
+        class dfs_range;
+
+        /**
+         * Return a range over every DIE in this unit in pre-order,
+         * starting with the root.  This reads the unit's data
+         * strictly sequentially and decodes each DIE exactly once,
+         * so it is the fastest way to visit a whole unit.  The
+         * iterator reports each DIE's depth and can skip its
+         * subtree.  As with iterating over children, the DIEs are
+         * temporary.  To scan every unit, see dwarf::advise.
+         */
+        dfs_range dfs() const;
+
+        /**
+         * Return a range over the DIEs in this unit with the given
+         * tag, in pre-order.  The other DIEs are still decoded, but
+         * not returned.
+         */
+        dfs_range dfs(DW_TAG tag) const;
+
         /**
          * \internal Return the data for this unit.
          */
@@ -257,6 +448,39 @@ public:
          */
         const abbrev_entry &get_abbrev(std::uint64_t acode) const;
 
+        /**
+         * \internal Return the decoded form of the expression at
+         * the specified offset in this unit's data.  This decodes
+         * the expression on first use and caches it in the unit
+         * without locking, so, like the rest of the dwarf object,
+         * it must not be called from several threads at once.
+         */
+        const expr_program &get_expr(section_offset offset,
+                                     section_length len) const;
+
+        /**
+         * \internal Return the .debug_str offset of the string with
+         * the given index in this unit's string offsets table, for
+         * the strx forms.
+         */
+        section_offset get_str_offset(std::uint64_t index) const;
+
+        /**
+         * \internal Return the address with the given index in this
+         * unit's address table, for the addrx forms.  A split unit's
+         * address table is in its skeleton's file.
+         */
+        taddr get_addr(std::uint64_t index) const;
+
+        /**
+         * \internal Set *origin to the DIE at the specified offset
+         * in this unit's data and *specification to the DIE its
+         * DW_AT::specification refers to, or an invalid DIE.  These
+         * are read once and cached for die::resolve.
+         */
+        void get_origin(section_offset offset, die *origin,
+                        die *specification) const;
+
 protected:
         friend struct ::std::hash<unit>;
         struct impl;
@@ -284,6 +508,41 @@ public:
          */
         compilation_unit(const dwarf &file, section_offset offset);
 
+        /**
+         * \internal Construct a compilation unit from a DWARF
+         * package, whose contributions to .debug_abbrev and
+         * .debug_str_offsets begin at abbrev_base and
+         * str_offsets_base.
+         */
+        compilation_unit(const dwarf &file, section_offset offset,
+                         section_offset abbrev_base,
+                         section_offset str_offsets_base);
+
+        /**
+         * Return true if this is a skeleton unit, whose DIEs are in a
+         * split unit in a .dwo file or DWARF package.  This is a
+         * DWARF 5 skeleton unit or a DWARF 4 unit with
+         * DW_AT_GNU_dwo_name.
+         */
+        bool is_skeleton() const;
+
+        /**
+         * Return the ID that matches a skeleton unit with its split
+         * unit, or 0 if this is neither.
+         */
+        uint64_t get_dwo_id() const;
+
+        /**
+         * Return the split unit holding the DIEs of this skeleton
+         * unit, or an invalid unit if this is not a skeleton unit.
+         * The first call opens the file's package (see
+         * dwarf::set_package_path) or else the .dwo file named by
+         * the skeleton, so opening a binary with split DWARF does not
+         * touch any of its .dwo files.  Throws format_error if the
+         * split unit cannot be found.
+         */
+        const compilation_unit &get_split_unit() const;
+
         /**
          * Return the line number table of this compilation unit.
          * Returns an invalid line table if this unit has no line
@@ -293,6 +552,19 @@ public:
 
         ::std::string comp_dir() const;
         ::std::string name() const;
+
+        /**
+         * Return this unit's DW_AT::comp_dir as a view of the
+         * string data, or an empty view if it has none.  Unlike
+         * comp_dir(), this does not append a trailing slash.
+         */
+        ::std::string_view comp_dir_view() const;
+
+        /**
+         * Return this unit's DW_AT::name as a view of the string
+         * data.
+         */
+        ::std::string_view name_view() const;
         uint8_t address_size() const;
 };
 
@@ -316,6 +588,17 @@ public:
          */
         type_unit(const dwarf &file, section_offset offset);
 
+        /**
+         * \internal Construct a type unit whose header begins offset
+         * bytes into section sec of file, which is .debug_types or,
+         * for DWARF 5, .debug_info.  For a unit from a DWARF
+         * package, its contributions to .debug_abbrev and
+         * .debug_str_offsets begin at abbrev_base and
+         * str_offsets_base.
+         */
+        type_unit(const dwarf &file, section_type sec, section_offset offset,
+                  section_offset abbrev_base, section_offset str_offsets_base);
+
         /**
          * Return the 64-bit unique signature that identifies this
          * type unit.  This is how DIEs from other units refer to type
@@ -353,7 +636,7 @@ class die
 public:
         DW_TAG tag;
 
-        die() : cu(nullptr), abbrev(nullptr) { }
+        die() : tag(), cu(nullptr), abbrev(nullptr), offset(0), next(0) { }
         die(const die &o) = default;
         die(die &&o) = default;
 
@@ -411,6 +694,10 @@ public:
          * a concrete inlined instance can specify another DIE as its
          * "abstract origin" and the original DIE will inherit the
          * attributes of its abstract origin (DWARF4 section 3.3.8.2).
+         *
+         * The unit holding the origin caches each origin DIE it
+         * reads without locking, so this must not be called from
+         * several threads at once on DIEs of the same dwarf object.
          */
         value resolve(DW_AT attr) const;
 
@@ -425,15 +712,26 @@ public:
         iterator begin() const;
         iterator end() const;
 
+        class attribute_iterator;
+        class attribute_range;
+
         /**
-         * Return a vector of the attributes of this DIE.
+         * Return a range over the attributes of this DIE as (name,
+         * value) pairs.  Each value is constructed as iteration
+         * reaches it, without allocating.  The range refers to this
+         * DIE, so the DIE must outlive it, unless this DIE is a
+         * temporary (as in v.as_reference().attributes()), in which
+         * case the range takes it over.  Iterators refer to the
+         * range, and the pairs are temporary.
          */
-        const std::vector<std::pair<DW_AT, value> > attributes() const;
+        attribute_range attributes() const &;
+        attribute_range attributes() &&;
 
         bool operator==(const die &o) const;
         bool operator!=(const die &o) const;
 
 private:
+        friend class dwarf;
         friend class unit;
         friend class type_unit;
         friend class value;
@@ -447,9 +745,11 @@ private:
         const abbrev_entry *abbrev;
         // The beginning of this DIE, relative to the CU.
         section_offset offset;
-        // Offsets of attributes, relative to cu's subsection.  The
-        // vast majority of DIEs tend to have six or fewer attributes,
-        // so we reserve space in the DIE itself for six attributes.
+        // Offsets of attributes, relative to cu's subsection.  A
+        // DW_FORM::implicit_const attribute has no data, so its slot
+        // holds the offset of this DIE.  The vast majority of DIEs
+        // tend to have six or fewer attributes, so we reserve space
+        // in the DIE itself for six attributes.
         small_vector<section_offset, 6> attrs;
         // The offset of the next DIE, relative to cu'd subsection.
         // This is set even for sibling list terminators.
@@ -523,6 +823,100 @@ die::end() const
         return iterator();
 }
 
+/**
+ * A pre-order iterator over the DIEs of a unit.
+ */
+class unit::dfs_iterator
+{
+public:
+        dfs_iterator() = default;
+        dfs_iterator(const dfs_iterator &o) = default;
+        dfs_iterator(dfs_iterator &&o) = default;
+
+        dfs_iterator& operator=(const dfs_iterator &o) = default;
+        dfs_iterator& operator=(dfs_iterator &&o) = default;
+
+        const die &operator*() const
+        {
+                return d;
+        }
+
+        const die *operator->() const
+        {
+                return &d;
+        }
+
+        /**
+         * Return the depth of the current DIE.  The root is at
+         * depth 0 and its children are at depth 1.
+         */
+        unsigned depth() const
+        {
+                return level;
+        }
+
+        /**
+         * Make the next increment skip the children of the current
+         * DIE.  This follows DW_AT::sibling if the DIE has one and
+         * otherwise reads past the subtree without returning it.
+         */
+        void skip_children()
+        {
+                skip = true;
+        }
+
+        // Only iterators over the same unit are comparable
+        bool operator!=(const dfs_iterator &o) const
+        {
+                if (!d.valid() || !o.d.valid())
+                        return d.valid() != o.d.valid();
+                return d.get_unit_offset() != o.d.get_unit_offset();
+        }
+
+        dfs_iterator &operator++();
+
+private:
+        friend class unit;
+
+        dfs_iterator(const unit *cu, bool filter, DW_TAG tag);
+
+        /**
+         * Read forward from next at depth next_level to the next DIE
+         * to return, or to the end of the unit.
+         */
+        void advance(section_offset next, unsigned next_level);
+
+        die d;
+        unsigned level = 0;
+        bool skip = false;
+        bool filter = false;
+        DW_TAG tag = DW_TAG();
+};
+
+/**
+ * The DIEs of a unit in pre-order.
+ */
+class unit::dfs_range
+{
+public:
+        dfs_iterator begin() const
+        {
+                return first;
+        }
+
+        dfs_iterator end() const
+        {
+                return dfs_iterator();
+        }
+
+private:
+        friend class unit;
+
+        dfs_range(const dfs_iterator &first) : first(first) { }
+
+        dfs_iterator first;
+};
+
 /**
  * An exception indicating that a value is not of the requested type.
  */
@@ -581,7 +975,7 @@ public:
         /**
          * Construct a value with type `type::invalid`.
          */
-        value() : cu(nullptr), typ(type::invalid) { }
+        value() : cu(nullptr), typ(type::invalid), implicit(0) { }
 
         value(const value &o) = default;
         value(value &&o) = default;
@@ -600,7 +994,8 @@ public:
 
         /**
          * Return this value's byte offset within its compilation
-         * unit.
+         * unit.  A DW_FORM::implicit_const value has no data in its
+         * DIE, so this is the offset of the DIE.
          */
         section_offset get_unit_offset() const
         {
@@ -608,7 +1003,9 @@ public:
         }
 
         /**
-         * Return this value's byte offset within its section.
+         * Return this value's byte offset within its section.  As
+         * with get_unit_offset, this is the offset of the DIE for a
+         * DW_FORM::implicit_const value.
          */
         section_offset get_section_offset() const;
 
@@ -649,7 +1046,10 @@ public:
         /**
          * Return this value as an unsigned constant.  This
          * automatically coerces "constant" type values by
-         * interpreting their bytes as unsigned.
+         * interpreting their bytes as unsigned.  For the DWARF 5
+         * loclistx and rnglistx forms, this returns the index of the
+         * list, since .debug_loclists and .debug_rnglists are not
+         * supported.
          */
         uint64_t as_uconstant() const;
 
@@ -689,6 +1089,14 @@ public:
          */
         die as_reference() const;
 
+        /**
+         * \internal For a reference type value, set *target and
+         * *target_offset to the unit of the referenced DIE and its
+         * offset in that unit's data, without reading the DIE.
+         */
+        void as_reference_location(const unit **target,
+                                   section_offset *target_offset) const;
+
         /**
          * Return this value as a string.
          */
@@ -710,6 +1118,14 @@ public:
          */
         const char *as_cstr(size_t *size_out = nullptr) const;
 
+        /**
+         * Return this value as a view of the string data in
+         * .debug_str, .debug_line_str or .debug_info.  Like as_cstr,
+         * this does not allocate, and the view is only valid as
+         * long as the section data.
+         */
+        std::string_view as_string_view() const;
+
         /**
          * Return this value as a section offset.  This is applicable
          * to lineptr, loclistptr, macptr, and rangelistptr.
@@ -720,7 +1136,8 @@ private:
         friend class die;
 
         value(const unit *cu,
-              DW_AT name, DW_FORM form, type typ, section_offset offset);
+              DW_AT name, DW_FORM form, type typ, section_offset offset,
+              int64_t implicit = 0);
 
         void resolve_indirect(DW_AT name);
 
@@ -728,6 +1145,9 @@ private:
         DW_FORM form;
         type typ;
         section_offset offset;
+        // The constant of a DW_FORM::implicit_const value, which is
+        // in the abbrev rather than at offset
+        int64_t implicit;
 };
 
 std::string
@@ -736,6 +1156,87 @@ to_string(value::type v);
 std::string
 to_string(const value &v);
 
+/**
+ * An iterator over the attributes of a DIE.
+ */
+class die::attribute_iterator
+{
+public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef std::pair<DW_AT, value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+
+        attribute_iterator() = default;
+        attribute_iterator(const attribute_iterator &o) = default;
+        attribute_iterator(attribute_iterator &&o) = default;
+
+        attribute_iterator& operator=(const attribute_iterator &o) = default;
+        attribute_iterator& operator=(attribute_iterator &&o) = default;
+
+        const std::pair<DW_AT, value> &operator*() const
+        {
+                return attr;
+        }
+
+        const std::pair<DW_AT, value> *operator->() const
+        {
+                return &attr;
+        }
+
+        // Only iterators over the same DIE are comparable
+        bool operator==(const attribute_iterator &o) const
+        {
+                return index == o.index;
+        }
+
+        bool operator!=(const attribute_iterator &o) const
+        {
+                return index != o.index;
+        }
+
+        attribute_iterator &operator++();
+
+private:
+        friend class die;
+
+        attribute_iterator(const die *d, unsigned index);
+
+        void decode();
+
+        // The range's DIE.  End iterators leave this null.
+        const die *d = nullptr;
+        unsigned index = 0;
+        std::pair<DW_AT, value> attr;
+};
+
+/**
+ * The attributes of a DIE.
+ */
+class die::attribute_range
+{
+public:
+        attribute_iterator begin() const;
+        attribute_iterator end() const;
+
+private:
+        friend class die;
+
+        attribute_range(const die *d) : ref(d) { }
+        attribute_range(die &&d) : ref(nullptr), owned(std::move(d)) { }
+
+        const die &get() const
+        {
+                return ref ? *ref : owned;
+        }
+
+        // The DIE, if the caller keeps it alive, or else null and
+        // the DIE is in owned
+        const die *ref;
+        die owned;
+};
+
 //////////////////////////////////////////////////////////////////
 // Expressions and location descriptions
 //
@@ -778,6 +1279,10 @@ public:
          * Throws expr_error if there is an error evaluating the
          * expression (such as an unknown operation, stack underflow,
          * bounds error, etc.)
+         *
+         * The decoded expression is cached in its unit, as
+         * unit::get_expr describes, so expressions of the same dwarf
+         * object must not be evaluated from several threads at once.
          */
         expr_result evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments) const;
 
@@ -814,6 +1319,16 @@ public:
                 throw expr_error("DW_OP_breg* operations not supported");
         }
 
+        /**
+         * Return the frame base of the current subprogram, as given
+         * by its DW_AT_frame_base.  This is used to implement
+         * DW_OP_fbreg operations.
+         */
+        virtual taddr frame_base()
+        {
+                throw expr_error("DW_OP_fbreg operations not supported");
+        }
+
         /**
          * Implement DW_OP_deref_size.
          */
@@ -846,6 +1361,162 @@ public:
  */
 extern expr_context no_expr_context;
 
+/**
+ * An expr_context that reads registers and memory from a core file.
+ * Registers come from a thread's NT_PRSTATUS note and memory reads
+ * are served from the core file's PT_LOAD segments.  Use
+ * dwarf::elf::create_core_context to construct one from an ELF core
+ * file.
+ *
+ * This class is internally reference counted and efficiently
+ * copyable, though each copy selects its thread independently.
+ */
+class core_context : public expr_context
+{
+public:
+        /**
+         * A memory region of the dumped process.  Bytes between
+         * file_size and mem_size read as zero.  If data is nullptr
+         * and load is set, load is called the first time the
+         * region's file data is needed and must return it.
+         */
+        struct region
+        {
+                taddr vaddr;
+                taddr mem_size;
+                taddr file_size;
+                const void *data;
+                std::function<const void *()> load;
+        };
+
+        /**
+         * The descriptor of an NT_PRSTATUS note.
+         */
+        struct prstatus
+        {
+                const void *data;
+                size_t size;
+        };
+
+        /**
+         * Construct a core context that is initially not valid.
+         */
+        core_context() = default;
+
+        /**
+         * Construct a core context from the given memory regions
+         * and per-thread NT_PRSTATUS descriptors.  machine is the
+         * ELF e_machine of the core file and msb is true if the
+         * file is big-endian.  The regions need not be sorted.
+         * keepalive is held as long as this context to keep the
+         * region and note data live.
+         */
+        core_context(unsigned machine, bool msb,
+                     std::vector<region> regions,
+                     std::vector<prstatus> threads,
+                     std::shared_ptr<const void> keepalive = nullptr);
+
+        bool valid() const
+        {
+                return !!m;
+        }
+
+        /**
+         * Return the number of threads in the core file.
+         */
+        size_t thread_count() const;
+
+        /**
+         * Use the registers of the thread at the given index, in the
+         * order of its NT_PRSTATUS note.  The first thread is the
+         * one that received the fatal signal.  Throws
+         * std::out_of_range if index is out of range.
+         */
+        void select_thread(size_t index);
+
+        /**
+         * Return a pointer to size bytes at address in the core
+         * file's data, or nullptr if those bytes are not all backed
+         * by a single segment's file data.  This does not copy.
+         */
+        const void *data_at(taddr address, size_t size) const;
+
+        /**
+         * Copy size bytes at address into buf.  Returns false if any
+         * of those bytes are not in the dumped memory.
+         */
+        bool read(taddr address, void *buf, size_t size) const;
+
+        taddr reg(unsigned regnum) override;
+        taddr deref_size(taddr address, unsigned size) override;
+
+private:
+        struct impl;
+        std::shared_ptr<impl> m;
+        size_t thread = 0;
+};
+
+/**
+ * An expr_context that reads registers and memory from a stopped
+ * process on the local machine.
+ *
+ * Memory is read with process_vm_readv and cached a page at a time,
+ * so repeated and neighboring reads do not each cost a system call.
+ * The cache is never invalidated implicitly: after the process runs,
+ * the caller must call invalidate().
+ *
+ * This class is internally reference counted and efficiently
+ * copyable.  Copies share one cache.
+ */
+class process_context : public expr_context
+{
+public:
+        /**
+         * Construct a process context that is initially not valid.
+         */
+        process_context() = default;
+
+        /**
+         * Construct a context for the process pid.  Reading memory
+         * requires ptrace access to pid.  Reading registers requires
+         * pid to be a stopped tracee of the calling thread.
+         */
+        explicit process_context(pid_t pid);
+
+        bool valid() const
+        {
+                return !!m;
+        }
+
+        /**
+         * Discard all cached memory and registers.
+         */
+        void invalidate();
+
+        /**
+         * Read the pages spanning size bytes at address into the
+         * cache using a single system call, such as before
+         * evaluating expressions that read the fields of one
+         * structure.  This stops at the first page that cannot be
+         * read; read() fetches later pages when it reaches them.
+         * This fetches at most as many pages as the cache holds.
+         */
+        void prefetch(taddr address, size_t size);
+
+        /**
+         * Copy size bytes at address into buf.  Returns false if any
+         * of those bytes cannot be read.
+         */
+        bool read(taddr address, void *buf, size_t size);
+
+        taddr reg(unsigned regnum) override;
+        taddr deref_size(taddr address, unsigned size) override;
+
+private:
+        struct impl;
+        std::shared_ptr<impl> m;
+};
+
 // XXX Provide methods to check type and fetch value?
 /**
  * The result of evaluating a DWARF expression or location
@@ -1264,6 +1935,15 @@ public:
          * "filename[:line[:column]]".
          */
         std::string get_description() const;
+
+        /**
+         * Write the same description as get_description() into buf,
+         * which has room for size bytes including the NUL
+         * terminator.  Like snprintf, this returns the length of the
+         * full description, so the output was truncated if this is
+         * size or more.  This does not allocate.
+         */
+        size_t get_description(char *buf, size_t size) const;
 };
 
 /**
@@ -1508,6 +2188,176 @@ private:
         bool step(cursor *cur);
 };
 
+//////////////////////////////////////////////////////////////////
+// Call frame information
+//
+
+/**
+ * The kind of rule used to recover a value in an unwind_table row.
+ */
+enum class unwind_rule_type : ubyte
+{
+        /**
+         * The value cannot be recovered.  A row whose CFA rule is
+         * undefined marks a PC range without call frame information.
+         */
+        undefined,
+        /**
+         * The value is unchanged from the callee.
+         */
+        same_value,
+        /**
+         * The value is saved in memory at address CFA+offset.
+         */
+        offset,
+        /**
+         * The value is CFA+offset.
+         */
+        val_offset,
+        /**
+         * The value is stored in register reg.  For the CFA rule,
+         * the CFA is the value of register reg plus offset.
+         */
+        reg,
+        /**
+         * The rule is a DWARF expression or otherwise does not fit
+         * in a row.  The caller must fall back to evaluating the
+         * call frame information for this PC.
+         */
+        expression,
+};
+
+std::string
+to_string(unwind_rule_type v);
+
+/**
+ * A single register rule in an unwind_table row.
+ */
+struct unwind_rule
+{
+        unwind_rule_type type;
+        ubyte reserved;
+        uhalf reg;
+        std::int32_t offset;
+};
+
+/**
+ * A row of an unwind_table.  A row applies to all PCs from pc up to
+ * the pc of the following row.  Rows are plain data with a fixed
+ * layout, so a table can be written out and mapped back in.
+ */
+struct unwind_row
+{
+        taddr pc;
+        unwind_rule cfa;
+        unwind_rule ra;
+        unwind_rule fp;
+};
+
+/**
+ * The raw call frame information sections of an object file.  Either
+ * section may be missing.
+ */
+struct cfi_data
+{
+        static const unsigned no_register = ~0u;
+
+        /**
+         * The .eh_frame section and its virtual address, which is
+         * needed to decode PC-relative pointers.
+         */
+        const void *eh_frame = nullptr;
+        size_t eh_frame_size = 0;
+        taddr eh_frame_addr = 0;
+
+        /**
+         * The .debug_frame section.
+         */
+        const void *debug_frame = nullptr;
+        size_t debug_frame_size = 0;
+
+        /**
+         * The target's address size in bytes and byte order.
+         */
+        unsigned addr_size = 8;
+        bool msb = false;
+
+        /**
+         * The DWARF register number of the target's frame pointer,
+         * or no_register if the fp rule should not be tracked.
+         */
+        unsigned fp_regno = no_register;
+};
+
+/**
+ * A flat, sorted table of unwind rules for the CFA, the return
+ * address, and the frame pointer, in the spirit of the Linux kernel's
+ * ORC tables.  The table is computed once by running all of the CFI
+ * programs of an object file and afterwards is independent of the
+ * object file, so lookups are a binary search with no CFI
+ * interpretation.
+ *
+ * This class is internally reference counted and efficiently
+ * copyable.
+ */
+class unwind_table
+{
+public:
+        /**
+         * Construct an empty unwind table.
+         */
+        unwind_table() = default;
+
+        /**
+         * Construct an unwind table by running the call frame
+         * programs in cfi.  Rows from .eh_frame take precedence over
+         * rows from .debug_frame that cover the same PCs.  Entries
+         * that cannot be parsed are skipped.  The table does not
+         * refer to the section data once constructed.
+         */
+        explicit unwind_table(const cfi_data &cfi);
+
+        /**
+         * Construct an unwind table over count rows previously
+         * produced by rows().  The rows are not copied, so the
+         * caller must keep them live as long as the table is in use.
+         */
+        unwind_table(const unwind_row *rows, size_t count);
+
+        unwind_table(const unwind_table &o) = default;
+        unwind_table(unwind_table &&o) = default;
+
+        unwind_table& operator=(const unwind_table &o) = default;
+        unwind_table& operator=(unwind_table &&o) = default;
+
+        /**
+         * Return the row that applies to pc, or nullptr if there is
+         * no call frame information for pc.
+         */
+        const unwind_row *find(taddr pc) const;
+
+        /**
+         * Return the rows of this table, sorted by PC.
+         */
+        const unwind_row *rows() const
+        {
+                return base;
+        }
+
+        /**
+         * Return the number of rows in this table.
+         */
+        size_t size() const
+        {
+                return count;
+        }
+
+private:
+        std::shared_ptr<std::vector<unwind_row> > owned;
+        const unwind_row *base = nullptr;
+        size_t count = 0;
+};
+
 //////////////////////////////////////////////////////////////////
 // Type-safe attribute getters
 //
@@ -1527,6 +2377,7 @@ uint64_t at_byte_stride(const die &d, expr_context *ctx);
 DW_CC at_calling_convention(const die &d);
 die at_common_reference(const die &d);
 std::string at_comp_dir(const die &d);
+std::string_view at_comp_dir_view(const die &d);
 value at_const_value(const die &d);
 bool at_const_expr(const die &d);
 die at_containing_type(const die &d);
@@ -1534,6 +2385,7 @@ uint64_t at_count(const die &d, expr_context *ctx);
 expr_result at_data_member_location(const die &d, expr_context *ctx, taddr base, taddr pc);
 bool at_declaration(const die &d);
 std::string at_description(const die &d);
+std::string_view at_description_view(const die &d);
 die at_discr(const die &d);
 value at_discr_value(const die &d);
 bool at_elemental(const die &d);
@@ -1552,17 +2404,21 @@ DW_INL at_inline(const die &d);
 bool at_is_optional(const die &d);
 DW_LANG at_language(const die &d);
 std::string at_linkage_name(const die &d);
+std::string_view at_linkage_name_view(const die &d);
 taddr at_low_pc(const die &d);
 uint64_t at_lower_bound(const die &d, expr_context *ctx);
 bool at_main_subprogram(const die &d);
 bool at_mutable(const die &d);
 std::string at_name(const die &d);
+std::string_view at_name_view(const die &d);
 die at_namelist_item(const die &d);
 die at_object_pointer(const die &d);
 DW_ORD at_ordering(const die &d);
 std::string at_picture_string(const die &d);
+std::string_view at_picture_string_view(const die &d);
 die at_priority(const die &d);
 std::string at_producer(const die &d);
+std::string_view at_producer_view(const die &d);
 bool at_prototyped(const die &d);
 bool at_pure(const die &d);
 rangelist at_ranges(const die &d);
@@ -1657,21 +2513,193 @@ namespace elf
          */
         const char *section_type_to_name(section_type type);
 
+        /**
+         * \internal Convert a dwarf::access_pattern to the
+         * equivalent elf::access_pattern, whose values match, without
+         * naming libelf++'s type.
+         */
+        struct access_pattern_cast
+        {
+                access_pattern pattern;
+
+                template<typename Pattern>
+                operator Pattern() const
+                {
+                        return (Pattern)pattern;
+                }
+        };
+
         template<typename Elf>
         class elf_loader : public loader
         {
+                typedef decltype(std::declval<const Elf&>().get_loader())
+                        elf_loader_ptr;
+
                 Elf f;
+                // If valid, the file to read sections from that f
+                // lacks or only has as NOBITS placeholders.  When f
+                // is a separate debug file, this is the stripped
+                // binary it belongs to.
+                Elf fallback;
+                // If true, f is a .dwo file or a DWARF package, whose
+                // sections have a ".dwo" suffix
+                bool split = false;
+                // Data this loader loaded from an ELF file's loader,
+                // by section.  Loading separately from the ELF
+                // section's own data lets release drop only what the
+                // DWARF object used.  Compressed sections are not
+                // here; their decompressed data is cached by the ELF
+                // section.
+                struct load_record
+                {
+                        elf_loader_ptr l;
+                        const void *data;
+                        size_t size;
+                };
+                std::map<section_type, load_record> loaded;
+                // Decompressions started by prefetch.  These must
+                // finish before f goes away.
+                std::vector<std::future<void> > pending;
+
+                /**
+                 * Return the ELF section of file holding the given
+                 * DWARF section, falling back to the legacy
+                 * compressed .zdebug name.
+                 */
+                decltype(auto)
+                find_in(const Elf &file, section_type section)
+                {
+                        const char *name = section_type_to_name(section);
+                        if (split) {
+                                // XXX With -fdebug-types-section, GCC
+                                // gives each unit of a .dwo file its
+                                // own COMDAT .debug_info.dwo, and
+                                // this finds only the first.  Packages
+                                // don't have this problem.
+                                //
+                                // The package indexes have no suffix
+                                auto &sec = file.get_section(std::string(name) + ".dwo");
+                                if (sec.valid())
+                                        return sec;
+                                return file.get_section(name);
+                        }
+                        auto &sec = file.get_section(name);
+                        if (sec.valid())
+                                return sec;
+                        // Replace ".debug" with ".zdebug"
+                        return file.get_section(std::string(".zdebug") + (name + 6));
+                }
+
+                /**
+                 * Return the ELF section holding the given DWARF
+                 * section and set *file to the file it is in.
+                 */
+                decltype(auto)
+                find_section(section_type section, const Elf **file)
+                {
+                        *file = &f;
+                        auto &sec = find_in(f, section);
+                        // SHT_NOBITS is 8
+                        if (!fallback.valid() ||
+                            (sec.valid() && (unsigned)sec.get_hdr().type != 8))
+                                return sec;
+                        *file = &fallback;
+                        return find_in(fallback, section);
+                }
 
         public:
                 elf_loader(const Elf &file) : f(file) { }
 
+                elf_loader(const Elf &file, const Elf &fallback)
+                        : f(file), fallback(fallback) { }
+
+                elf_loader(const Elf &file, bool split)
+                        : f(file), split(split) { }
+
                 const void *load(section_type section, size_t *size_out)
                 {
-                        auto sec = f.get_section(section_type_to_name(section));
+                        const Elf *file;
+                        auto &sec = find_section(section, &file);
                         if (!sec.valid())
                                 return nullptr;
-                        *size_out = sec.size();
-                        return sec.data();
+                        auto &hdr = sec.get_hdr();
+                        *size_out = hdr.size;
+                        // SHT_NOBITS is 8
+                        if ((unsigned)hdr.type == 8)
+                                return nullptr;
+                        if (sec.is_compressed()) {
+                                const void *data = sec.uncompressed_data();
+                                *size_out = sec.uncompressed_size();
+                                return data;
+                        }
+                        auto it = loaded.find(section);
+                        if (it != loaded.end())
+                                return it->second.data;
+                        auto l = file->get_loader();
+                        const void *data = l->load(hdr.offset, hdr.size);
+                        loaded[section] = load_record{l, data, hdr.size};
+                        return data;
+                }
+
+                void release(section_type section)
+                {
+                        auto it = loaded.find(section);
+                        if (it == loaded.end())
+                                return;
+                        it->second.l->release(it->second.data,
+                                              it->second.size);
+                        loaded.erase(it);
+                }
+
+                void prefetch(section_type section)
+                {
+                        if (loaded.count(section))
+                                return;
+                        const Elf *file;
+                        auto &sec = find_section(section, &file);
+                        if (!sec.valid())
+                                return;
+                        auto &hdr = sec.get_hdr();
+                        // SHT_NOBITS is 8
+                        if ((unsigned)hdr.type == 8)
+                                return;
+                        if (sec.is_compressed()) {
+                                // Load the compressed data here, since
+                                // that isn't thread-safe, and
+                                // decompress it in the background.
+                                // is_compressed() has also looked up
+                                // the name of a .zdebug section here,
+                                // so the background thread only reads
+                                // the section.  If decompression
+                                // fails, load will retry and report
+                                // the error.
+                                sec.data();
+                                auto copy = sec;
+                                pending.push_back(std::async(
+                                        std::launch::async,
+                                        [copy] { copy.uncompressed_data(); }));
+                                return;
+                        }
+                        file->get_loader()->prefetch(hdr.offset, hdr.size);
+                }
+
+                void advise(section_type section, access_pattern pattern)
+                {
+                        const Elf *file;
+                        auto &sec = find_section(section, &file);
+                        if (!sec.valid())
+                                return;
+                        auto &hdr = sec.get_hdr();
+                        file->get_loader()->advise(hdr.offset, hdr.size,
+                                                   access_pattern_cast{pattern});
+                }
+
+                std::shared_ptr<loader> open_split(const std::string &path)
+                {
+                        Elf file = Elf::open(path);
+                        if (!file.valid())
+                                return nullptr;
+                        return std::make_shared<elf_loader<Elf> >(file, true);
                 }
         };
 
@@ -1686,6 +2714,133 @@ namespace elf
         {
                 return std::make_shared<elf_loader<Elf> >(f);
         }
+
+        /**
+         * Create a DWARF section loader for f that reads sections
+         * from debug, f's separate debug file (for example, from
+         * elf::debug_resolver), and from f itself for sections debug
+         * lacks.  If debug is not valid, this is the same as
+         * create_loader(f).
+         */
+        template<typename Elf>
+        std::shared_ptr<elf_loader<Elf> > create_loader(const Elf &f,
+                                                        const Elf &debug)
+        {
+                if (!debug.valid())
+                        return std::make_shared<elf_loader<Elf> >(f);
+                return std::make_shared<elf_loader<Elf> >(debug, f);
+        }
+
+        /**
+         * Create a DWARF section loader for f, a .dwo file or DWARF
+         * package (.dwp) holding split DWARF.  dwarf objects find
+         * these files themselves when resolving skeleton units, so
+         * this is only needed to read such a file on its own.
+         */
+        template<typename Elf>
+        std::shared_ptr<elf_loader<Elf> > create_split_loader(const Elf &f)
+        {
+                return std::make_shared<elf_loader<Elf> >(f, true);
+        }
+
+        /**
+         * Return the DWARF register number of the frame pointer for
+         * the given ELF machine type, or cfi_data::no_register if
+         * the machine is not known.
+         */
+        unsigned frame_pointer_regno(unsigned machine);
+
+        /**
+         * Build an unwind table from the .eh_frame and .debug_frame
+         * sections of the given ELF file, decompressing .debug_frame
+         * if necessary.  Both sections are advised sequential through
+         * the file's loader before they are parsed.  The returned
+         * table does not depend on the ELF file or any DWARF object.
+         * Throws format_error if .debug_frame cannot be decompressed.
+         */
+        template<typename Elf>
+        unwind_table create_unwind_table(const Elf &f)
+        {
+                cfi_data cfi;
+                auto &hdr = f.get_hdr();
+                // ELFCLASS32 is 1 and ELFDATA2MSB is 2
+                cfi.addr_size = (unsigned)hdr.ei_class == 1 ? 4 : 8;
+                cfi.msb = (unsigned)hdr.ei_data == 2;
+                cfi.fp_regno = frame_pointer_regno(hdr.machine);
+
+                // Both sections are parsed front to back
+                auto advise = [&](const auto &sec) {
+                        f.get_loader()->advise(
+                                sec.get_hdr().offset, sec.get_hdr().size,
+                                access_pattern_cast{access_pattern::sequential});
+                };
+                auto &eh = f.get_section(".eh_frame");
+                if (eh.valid())
+                        advise(eh);
+                if (eh.valid() && eh.data()) {
+                        cfi.eh_frame = eh.data();
+                        cfi.eh_frame_size = eh.size();
+                        cfi.eh_frame_addr = eh.get_hdr().addr;
+                }
+                // .debug_frame may be compressed, or be the legacy
+                // GNU .zdebug_frame
+                const auto *df = &f.get_section(".debug_frame");
+                if (!df->valid())
+                        df = &f.get_section(".zdebug_frame");
+                if (df->valid())
+                        advise(*df);
+                if (df->valid() && df->data()) {
+                        cfi.debug_frame = df->uncompressed_data();
+                        cfi.debug_frame_size = df->uncompressed_size();
+                }
+                return unwind_table(cfi);
+        }
+
+        /**
+         * Create an expression context for the given ELF core file.
+         * Throws format_error if f is not a core file.
+         */
+        template<typename Elf>
+        core_context create_core_context(const Elf &f)
+        {
+                auto &hdr = f.get_hdr();
+                // ET_CORE is 4
+                if ((unsigned)hdr.type != 4)
+                        throw format_error("not an ELF core file");
+
+                std::vector<core_context::region> regions;
+                std::vector<core_context::prstatus> threads;
+                auto l = f.get_loader();
+                for (auto &seg : f.segments()) {
+                        auto &phdr = seg.get_hdr();
+                        // PT_LOAD is 1 and PT_NOTE is 4
+                        if ((unsigned)phdr.type == 1) {
+                                // Cores can be as large as the
+                                // process, so only load the segments
+                                // that are read
+                                core_context::region r{
+                                        phdr.vaddr, phdr.memsz, phdr.filesz,
+                                        nullptr, nullptr};
+                                if (phdr.filesz)
+                                        r.load = [l, off = phdr.offset,
+                                                  size = phdr.filesz]() {
+                                                return l->load(off, size);
+                                        };
+                                regions.push_back(std::move(r));
+                        } else if ((unsigned)phdr.type == 4) {
+                                // NT_PRSTATUS is 1
+                                for (auto n : seg.as_notes())
+                                        if (n.get_hdr().type == 1 &&
+                                            std::strcmp(n.get_name(), "CORE") == 0)
+                                                threads.push_back(
+                                                        {n.get_desc(),
+                                                         n.get_desc_size()});
+                        }
+                }
+                return core_context(hdr.machine, (unsigned)hdr.ei_data == 2,
+                                    std::move(regions), std::move(threads),
+                                    f.get_loader());
+        }
 };
 
 DWARFPP_END_NAMESPACE
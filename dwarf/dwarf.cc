@@ -4,39 +4,216 @@
 
 #include "internal.hh"
 
+#include <algorithm>
+
 using namespace std;
 
 DWARFPP_BEGIN_NAMESPACE
 
+//////////////////////////////////////////////////////////////////
+// class package_index
+//
+
+/**
+ * The unit index of a DWARF package file, from .debug_cu_index or
+ * .debug_tu_index (DWARF5 section 7.3.5.3, which also describes
+ * GNU's version 2 for DWARF 4).  Lookups probe the index's hash
+ * table where it lies, so there is nothing to build.
+ */
+struct package_index
+{
+        // Section identifiers (DW_SECT_*) of the columns we use.
+        // These are the same in versions 2 and 5, except that only
+        // version 2 has .debug_types.
+        static const uword sect_info = 1;
+        static const uword sect_types = 2;
+        static const uword sect_abbrev = 3;
+        static const uword sect_str_offsets = 6;
+
+        bool have_index;
+        std::shared_ptr<section> sec;
+        uhalf version;
+        uword ncols, nunits, nslots;
+
+        package_index()
+                : have_index(false), version(0), ncols(0), nunits(0),
+                  nslots(0) { }
+
+        /**
+         * Read the index from the given section of file the first
+         * time this is called.  If file has no such section, the
+         * index is empty.
+         */
+        void force(const dwarf &file, section_type type);
+
+        /**
+         * Return the 1-based row of the unit with the given signature,
+         * or 0 if there is no such unit.
+         */
+        uword find(uint64_t signature) const;
+
+        /**
+         * Return the offset of row's contribution to the section with
+         * the given DW_SECT identifier, or 0 if units do not
+         * contribute to that section.
+         */
+        section_offset contribution(uword row, uword sect) const;
+};
+
+void
+package_index::force(const dwarf &file, section_type type)
+{
+        if (have_index)
+                return;
+        have_index = true;
+        if (!file.has_section(type))
+                return;
+
+        sec = file.get_section(type);
+        cursor cur(sec);
+        // Version 2 has a 4 byte version and version 5 has a 2 byte
+        // version and 2 bytes of padding, so one of the halves is 0
+        // in either byte order
+        uhalf v1 = cur.fixed<uhalf>(), v2 = cur.fixed<uhalf>();
+        version = v1 ? v1 : v2;
+        if (version != 2 && version != 5)
+                throw format_error("unknown package index version " +
+                                   std::to_string(version));
+        ncols = cur.fixed<uword>();
+        nunits = cur.fixed<uword>();
+        nslots = cur.fixed<uword>();
+        if (nslots & (nslots - 1))
+                throw format_error("package index size is not a power of 2");
+        // The hash table, then the column headers, then the offset
+        // and size tables
+        cur.ensure((section_offset)nslots * 12 +
+                   (section_offset)ncols * 4 * (1 + 2 * (section_offset)nunits));
+}
+
+uword
+package_index::find(uint64_t signature) const
+{
+        if (nslots == 0)
+                return 0;
+        // Open addressing with double hashing
+        uint64_t mask = nslots - 1;
+        uint64_t slot = signature & mask;
+        uint64_t step = ((signature >> 32) & mask) | 1;
+        for (uword i = 0; i < nslots; i++) {
+                cursor cur(sec, 16 + slot * 8);
+                uint64_t hash = cur.fixed<uint64_t>();
+                cur = cursor(sec, 16 + nslots * 8 + slot * 4);
+                uword row = cur.fixed<uword>();
+                if (row == 0)
+                        return 0;
+                if (hash == signature)
+                        return row <= nunits ? row : 0;
+                slot = (slot + step) & mask;
+        }
+        return 0;
+}
+
+section_offset
+package_index::contribution(uword row, uword sect) const
+{
+        section_offset headers = 16 + (section_offset)nslots * 12;
+        cursor cur(sec, headers);
+        for (uword col = 0; col < ncols; col++) {
+                if (cur.fixed<uword>() != sect)
+                        continue;
+                cursor off(sec, headers + ((section_offset)row * ncols + col) * 4);
+                return off.fixed<uword>();
+        }
+        return 0;
+}
+
 //////////////////////////////////////////////////////////////////
 // class dwarf
 //
 
 struct dwarf::impl
 {
-        impl(const std::shared_ptr<loader> &l)
-                : l(l), have_type_units(false) { }
+        impl(const std::shared_ptr<loader> &l, bool is_package)
+                : l(l), is_package(is_package), have_package(false),
+                  have_types_index(false) { }
 
         std::shared_ptr<loader> l;
+        // Whether this file is a DWARF package (.dwp), whose units
+        // are only found through its indexes
+        bool is_package;
 
         std::shared_ptr<section> sec_info;
         std::shared_ptr<section> sec_abbrev;
 
+        // For split DWARF, the package to search for split units and
+        // the .dwo files opened so far, by path.  Each is opened the
+        // first time it is needed.  Split units refer to these
+        // through borrowed handles.
+        std::string package_path;
+        bool have_package;
+        dwarf package;
+        std::unordered_map<std::string, dwarf> dwo_files;
+
+        // If this file is a package, its unit indexes, read lazily
+        package_index cu_index, tu_index;
+
         std::vector<compilation_unit> compilation_units;
 
-        std::unordered_map<uint64_t, type_unit> type_units;
-        bool have_type_units;
+        // Type units by signature.  DWARF 5 type units in
+        // .debug_info are indexed when the file is opened, since
+        // every unit header is read then anyway.  .debug_types is
+        // only indexed the first time a signature is looked up, and
+        // each type_unit is only constructed the first time its
+        // signature is looked up.  A package's type units are added
+        // from its index as they are looked up instead, since they
+        // need the bases of their contributions.
+        struct type_unit_entry
+        {
+                section_type sec;
+                section_offset offset;
+                section_offset abbrev_base, str_offsets_base;
+                type_unit tu;
+        };
+        std::unordered_map<uint64_t, type_unit_entry> type_units;
+        bool have_types_index;
+
+        /**
+         * Read the unit header in sec at cur and, if it is a type
+         * unit, add it to type_units.  Return true if it was a type
+         * unit.  Advances cur past the unit.
+         */
+        bool index_type_unit(section_type sec, cursor *cur);
 
         std::map<section_type, std::shared_ptr<section> > sections;
+
+        ~impl()
+        {
+                // Units and sections referring to the section data
+                // are owned by this object, so nothing can use it now
+                if (sec_info)
+                        l->release(section_type::info);
+                if (sec_abbrev)
+                        l->release(section_type::abbrev);
+                for (auto &sec : sections)
+                        if (sec.second)
+                                l->release(sec.first);
+        }
 };
 
 dwarf::dwarf(const std::shared_ptr<loader> &l)
-        : m(make_shared<impl>(l))
+        : dwarf(l, false)
+{
+}
+
+dwarf::dwarf(const std::shared_ptr<loader> &l, bool package)
+        : m(make_shared<impl>(l, package))
 {
         const void *data;
         size_t size;
 
-        // Get required sections
+        // Get required sections.  Let the loader read .debug_abbrev
+        // while we wait for .debug_info.
+        l->prefetch(section_type::abbrev);
         data = l->load(section_type::info, &size);
         if (!data)
                 throw format_error("required .debug_info section missing");
@@ -63,19 +240,51 @@ dwarf::dwarf(const std::shared_ptr<loader> &l)
         shared_impl->sec_abbrev = make_shared<section>(section_type::abbrev, data, size, shared_impl->sec_info->ord);
 
         // Get compilation units.  Everything derives from these, so
-        // there's no point in doing it lazily.
+        // there's no point in doing it lazily.  A package's units are
+        // only read when a skeleton unit asks for them.  DWARF 5 type
+        // units are also in .debug_info; set those aside.
+        if (package)
+                return;
         cursor infocur(shared_impl->sec_info);
-        auto weakCopy = get_weak_copy();
+        auto borrowed = get_borrowed_copy();
+        // This touches every unit in order
+        l->advise(section_type::info, access_pattern::sequential);
         while (!infocur.end()) {
-                // XXX Circular reference.  Given that we now require
-                // the dwarf object to stick around for DIEs, maybe we
-                // might as well require that for units, too.
-                shared_impl->compilation_units.emplace_back(
-                        weakCopy, infocur.get_section_offset());
-                infocur.subsection();
+                section_offset offset = infocur.get_section_offset();
+                if (!shared_impl->index_type_unit(section_type::info, &infocur))
+                        shared_impl->compilation_units.emplace_back(
+                                borrowed, offset);
         }
 }
 
+bool
+dwarf::impl::index_type_unit(section_type sec, cursor *cur)
+{
+        // Read just enough of the header (DWARF4 section 7.5.1.2,
+        // DWARF5 section 7.5.1.3) to find the signature
+        section_offset offset = cur->get_section_offset();
+        cursor sub(cur->subsection());
+        sub.skip_initial_length();
+        uhalf version = sub.fixed<uhalf>();
+        if (version == 5) {
+                DW_UT unit_type = (DW_UT)sub.fixed<ubyte>();
+                if (unit_type != DW_UT::type &&
+                    unit_type != DW_UT::split_type)
+                        return false;
+                sub.fixed<ubyte>();     // address_size
+                sub.offset();           // debug_abbrev_offset
+        } else if (sec == section_type::types) {
+                sub.offset();           // debug_abbrev_offset
+                sub.fixed<ubyte>();     // address_size
+        } else {
+                return false;
+        }
+        uint64_t type_signature = sub.fixed<uint64_t>();
+        type_units.try_emplace(type_signature,
+                               type_unit_entry{sec, offset, 0, 0, type_unit()});
+        return true;
+}
+
 dwarf::~dwarf()
 {
 }
@@ -93,19 +302,71 @@ const type_unit &
 dwarf::get_type_unit(uint64_t type_signature) const
 {
         auto &impl = m.Get();
-        if (!impl.have_type_units) {
-                cursor tucur(get_section(section_type::types));
-                while (!tucur.end()) {
-                        // XXX Circular reference
-                        type_unit tu(*this, tucur.get_section_offset());
-                        impl.type_units[tu.get_type_signature()] = tu;
-                        tucur.subsection();
+        if (!impl.have_types_index) {
+                impl.have_types_index = true;
+                if (!impl.is_package && has_section(section_type::types)) {
+                        cursor tucur(get_section(section_type::types));
+                        while (!tucur.end())
+                                impl.index_type_unit(section_type::types, &tucur);
                 }
-                impl.have_type_units = true;
         }
-        if (!impl.type_units.count(type_signature))
-                throw out_of_range("type signature 0x" + to_hex(type_signature));
-        return impl.type_units[type_signature];
+
+        auto it = impl.type_units.find(type_signature);
+        if (it == impl.type_units.end()) {
+                // A package's type units are found through its index
+                auto &index = impl.tu_index;
+                index.force(*this, section_type::tu_index);
+                uword row = index.find(type_signature);
+                if (!row)
+                        throw out_of_range("type signature 0x" + to_hex(type_signature));
+                bool types = index.version == 2;
+                impl::type_unit_entry entry{
+                        types ? section_type::types : section_type::info,
+                        index.contribution(row, types ? package_index::sect_types :
+                                           package_index::sect_info),
+                        index.contribution(row, package_index::sect_abbrev),
+                        index.contribution(row, package_index::sect_str_offsets),
+                        type_unit()};
+                it = impl.type_units.emplace(type_signature, entry).first;
+        }
+
+        auto &entry = it->second;
+        if (!entry.tu.valid())
+                entry.tu = type_unit(get_borrowed_copy(), entry.sec,
+                                     entry.offset, entry.abbrev_base,
+                                     entry.str_offsets_base);
+        return entry.tu;
+}
+
+die
+dwarf::die_at_offset(section_offset offset) const
+{
+        const compilation_unit &cu = unit_at_offset(offset);
+        die d(&cu);
+        d.read(offset - cu.get_section_offset());
+        return d;
+}
+
+const compilation_unit &
+dwarf::unit_at_offset(section_offset offset) const
+{
+        // Find the last unit that starts at or before offset
+        auto &cus = compilation_units();
+        auto it = upper_bound(
+                cus.begin(), cus.end(), offset,
+                [](section_offset o, const compilation_unit &cu) {
+                        return o < cu.get_section_offset();
+                });
+        if (it == cus.begin())
+                throw out_of_range("no unit at .debug_info offset 0x" + to_hex(offset));
+        --it;
+        section_offset unit_offset = offset - it->get_section_offset();
+        // Offsets into a unit's header or past its end (say, into a
+        // type unit) belong to no compilation unit
+        if (unit_offset >= it->data()->size() ||
+            unit_offset < it->root().get_unit_offset())
+                throw out_of_range("no unit at .debug_info offset 0x" + to_hex(offset));
+        return *it;
 }
 
 std::shared_ptr<section>
@@ -139,10 +400,115 @@ dwarf::has_section(section_type type) const
         if (!data)
                 return false;
 
-        impl.sections[type] = std::make_shared<section>(section_type::str, data, size, impl.sec_info->ord);
+        impl.sections[type] = std::make_shared<section>(type, data, size, impl.sec_info->ord);
         return true;
 }
 
+void
+dwarf::prefetch(const std::initializer_list<section_type> &types) const
+{
+        auto &impl = m.Get();
+        for (auto type : types) {
+                if (type == section_type::info ||
+                    type == section_type::abbrev ||
+                    impl.sections.count(type))
+                        continue;
+                impl.l->prefetch(type);
+        }
+}
+
+void
+dwarf::advise(section_type type, access_pattern pattern) const
+{
+        m.Get().l->advise(type, pattern);
+}
+
+void
+dwarf::set_package_path(const std::string &path)
+{
+        auto &impl = m.Get();
+        impl.package_path = path;
+        impl.have_package = false;
+        impl.package = dwarf();
+}
+
+compilation_unit
+dwarf::find_split_unit(uint64_t dwo_id, const std::string &path) const
+{
+        auto &impl = m.Get();
+
+        if (!impl.have_package) {
+                impl.have_package = true;
+                if (!impl.package_path.empty()) {
+                        auto l = impl.l->open_split(impl.package_path);
+                        if (l)
+                                impl.package = dwarf(l, true);
+                }
+        }
+        if (impl.package.valid()) {
+                auto &pkg = impl.package.m.Get();
+                pkg.cu_index.force(impl.package, section_type::cu_index);
+                uword row = pkg.cu_index.find(dwo_id);
+                if (row)
+                        return compilation_unit(
+                                impl.package.get_borrowed_copy(),
+                                pkg.cu_index.contribution(row, package_index::sect_info),
+                                pkg.cu_index.contribution(row, package_index::sect_abbrev),
+                                pkg.cu_index.contribution(row, package_index::sect_str_offsets));
+        }
+
+        auto it = impl.dwo_files.find(path);
+        if (it == impl.dwo_files.end()) {
+                // Remember missing files, too
+                dwarf dwo;
+                auto l = impl.l->open_split(path);
+                if (l)
+                        dwo = dwarf(l);
+                it = impl.dwo_files.emplace(path, dwo).first;
+        }
+        if (it->second.valid()) {
+                for (auto &cu : it->second.compilation_units())
+                        if (cu.get_dwo_id() == dwo_id)
+                                return cu;
+        }
+        throw format_error("split unit 0x" + to_hex(dwo_id) + " not found in " +
+                           (impl.package.valid() ? impl.package_path + " or " : "") +
+                           path);
+}
+
+//////////////////////////////////////////////////////////////////
+// class memory_loader
+//
+
+class memory_loader : public loader
+{
+        std::map<section_type, std::pair<const void*, size_t> > sections;
+        std::shared_ptr<const void> keepalive;
+
+public:
+        memory_loader(
+                const std::map<section_type, std::pair<const void*, size_t> > &sections,
+                std::shared_ptr<const void> keepalive)
+                : sections(sections), keepalive(move(keepalive)) { }
+
+        const void *load(section_type section, size_t *size_out)
+        {
+                auto it = sections.find(section);
+                if (it == sections.end())
+                        return nullptr;
+                *size_out = it->second.second;
+                return it->second.first;
+        }
+};
+
+std::shared_ptr<loader>
+create_memory_loader(
+        const std::map<section_type, std::pair<const void*, size_t> > &sections,
+        std::shared_ptr<const void> keepalive)
+{
+        return make_shared<memory_loader>(sections, move(keepalive));
+}
+
 //////////////////////////////////////////////////////////////////
 // class unit
 //
@@ -175,6 +541,40 @@ struct unit::impl
         std::vector<abbrev_entry> abbrevs_vec;
         std::unordered_map<abbrev_code, abbrev_entry> abbrevs_map;
 
+        // Decoded expressions, by offset in subsec
+        std::unordered_map<section_offset, expr_program> exprs;
+
+        // DIEs that abstract_origin or specification attributes
+        // refer to, by offset in subsec, with the DIEs their own
+        // specification refers to.  Each DIE's unit pointer is
+        // whichever unit object first read it, so get_origin points
+        // same-unit DIEs back at the unit object asking.
+        struct origin_chain
+        {
+                die origin, specification;
+                bool specification_here;
+        };
+        std::unordered_map<section_offset, origin_chain> origins;
+
+        // Unit header fields.  Units before DWARF 5 have no unit
+        // type, so they get DW_UT::compile or DW_UT::type.
+        uhalf version;
+        DW_UT unit_type;
+        uint64_t dwo_id;
+
+        // Bases of this unit's entries in .debug_str_offsets and
+        // .debug_addr, and the file whose .debug_addr they index.
+        // These are found from the root DIE on first use, except
+        // that a split unit gets its address base from its skeleton.
+        // Before then, str_offsets_base is the start of the unit's
+        // contribution to a package's .debug_str_offsets.
+        bool have_str_offsets_base, have_addr_base;
+        section_offset str_offsets_base, addr_base;
+        dwarf addr_file;
+
+        // For a skeleton unit, its split unit, found lazily
+        compilation_unit split;
+
         impl(const dwarf &file, section_offset offset,
              const std::shared_ptr<section> &subsec,
              section_offset debug_abbrev_offset, section_offset root_offset,
@@ -182,9 +582,25 @@ struct unit::impl
                 : file(file), offset(offset), subsec(subsec),
                   debug_abbrev_offset(debug_abbrev_offset),
                   root_offset(root_offset), type_signature(type_signature),
-                  type_offset(type_offset), have_abbrevs(false) { }
+                  type_offset(type_offset), have_abbrevs(false),
+                  version(0), unit_type(DW_UT::compile), dwo_id(0),
+                  have_str_offsets_base(false), have_addr_base(false),
+                  str_offsets_base(0), addr_base(0) { }
 
         void force_abbrevs();
+        void force_addr_base(const die &root);
+
+        /**
+         * Return the size of the header of this unit's contributions
+         * to .debug_str_offsets and .debug_addr, which only DWARF 5
+         * has.
+         */
+        section_length base_header_size() const
+        {
+                if (version < 5)
+                        return 0;
+                return subsec->fmt == format::dwarf64 ? 16 : 8;
+        }
 };
 
 unit::~unit()
@@ -214,6 +630,18 @@ unit::root() const
         return m->root;
 }
 
+unit::dfs_range
+unit::dfs() const
+{
+        return dfs_range(dfs_iterator(this, false, DW_TAG()));
+}
+
+unit::dfs_range
+unit::dfs(DW_TAG tag) const
+{
+        return dfs_range(dfs_iterator(this, true, tag));
+}
+
 const std::shared_ptr<section> &
 unit::data() const
 {
@@ -244,6 +672,102 @@ unknown:
         throw format_error("unknown abbrev code 0x" + to_hex(acode));
 }
 
+const expr_program &
+unit::get_expr(section_offset offset, section_length len) const
+{
+        auto it = m->exprs.find(offset);
+        if (it == m->exprs.end())
+                it = m->exprs.try_emplace(offset, this, offset, len).first;
+        return it->second;
+}
+
+void
+unit::get_origin(section_offset offset, die *origin, die *specification) const
+{
+        auto it = m->origins.find(offset);
+        if (it == m->origins.end()) {
+                impl::origin_chain chain{die(this), die(), false};
+                chain.origin.read(offset);
+                if (chain.origin.has(DW_AT::specification)) {
+                        chain.specification =
+                                chain.origin[DW_AT::specification].as_reference();
+                        chain.specification_here =
+                                *chain.specification.cu == *this;
+                }
+                it = m->origins.emplace(offset, chain).first;
+        }
+        *origin = it->second.origin;
+        origin->cu = this;
+        *specification = it->second.specification;
+        if (it->second.specification_here)
+                specification->cu = this;
+}
+
+section_offset
+unit::get_str_offset(uint64_t index) const
+{
+        if (!m->have_str_offsets_base) {
+                // Split units have no DW_AT_str_offsets_base; their
+                // table follows the header of their contribution
+                const die &d = root();
+                if (d.has(DW_AT::str_offsets_base))
+                        m->str_offsets_base += d[DW_AT::str_offsets_base].as_sec_offset();
+                else
+                        m->str_offsets_base += m->base_header_size();
+                m->have_str_offsets_base = true;
+        }
+
+        auto sec = m->file.get_section(section_type::str_offsets);
+        unsigned size = m->subsec->fmt == format::dwarf64 ? 8 : 4;
+        if (m->str_offsets_base > sec->size() ||
+            index >= (sec->size() - m->str_offsets_base) / size)
+                throw format_error("string index " + std::to_string(index) +
+                                   " out of range");
+        cursor cur(sec, m->str_offsets_base + index * size);
+        if (size == 8)
+                return cur.fixed<uint64_t>();
+        return cur.fixed<uword>();
+}
+
+taddr
+unit::get_addr(uint64_t index) const
+{
+        if (!m->have_addr_base)
+                m->force_addr_base(root());
+
+        auto sec = m->addr_file.get_section(section_type::addr);
+        unsigned size = m->subsec->addr_size;
+        if (m->addr_base > sec->size() ||
+            index >= (sec->size() - m->addr_base) / size)
+                throw format_error("address index " + std::to_string(index) +
+                                   " out of range");
+        cursor cur(sec, m->addr_base + index * size);
+        switch (size) {
+        case 4:
+                return cur.fixed<uword>();
+        case 8:
+                return cur.fixed<uint64_t>();
+        default:
+                throw format_error("address size " + std::to_string(size) +
+                                   " not supported");
+        }
+}
+
+void
+unit::impl::force_addr_base(const die &root)
+{
+        if (have_addr_base)
+                return;
+        addr_file = file;
+        if (root.has(DW_AT::addr_base))
+                addr_base = root[DW_AT::addr_base].as_sec_offset();
+        else if (root.has(DW_AT::GNU_addr_base))
+                addr_base = root[DW_AT::GNU_addr_base].as_sec_offset();
+        else
+                addr_base = base_header_size();
+        have_addr_base = true;
+}
+
 void
 unit::impl::force_abbrevs()
 {
@@ -278,13 +802,93 @@ unit::impl::force_abbrevs()
         have_abbrevs = true;
 }
 
+//////////////////////////////////////////////////////////////////
+// class unit::dfs_iterator
+//
+
+unit::dfs_iterator::dfs_iterator(const unit *cu, bool filter, DW_TAG tag)
+        : d(cu->root()), filter(filter), tag(tag)
+{
+        if (filter && d.tag != tag)
+                advance(d.next, d.abbrev->children ? 1 : 0);
+}
+
+unit::dfs_iterator &
+unit::dfs_iterator::operator++()
+{
+        if (!d.valid())
+                return *this;
+
+        if (!d.abbrev->children) {
+                advance(d.next, level);
+        } else if (!skip) {
+                advance(d.next, level + 1);
+        } else if (d.has(DW_AT::sibling)) {
+                const unit *target;
+                section_offset sibling;
+                d[DW_AT::sibling].as_reference_location(&target, &sibling);
+                advance(sibling, level);
+        } else {
+                // Read to the null entry that ends the subtree
+                const unit *cu = d.cu;
+                section_offset next = d.next;
+                unsigned nesting = 1;
+                die sub(cu);
+                while (nesting && next < cu->data()->size()) {
+                        sub.read(next);
+                        if (!sub.abbrev)
+                                nesting--;
+                        else if (sub.abbrev->children)
+                                nesting++;
+                        next = sub.next;
+                }
+                advance(next, level);
+        }
+        return *this;
+}
+
+void
+unit::dfs_iterator::advance(section_offset next, unsigned next_level)
+{
+        skip = false;
+        const unit *cu = d.cu;
+        size_t size = cu->data()->size();
+        // Depth 0 only holds the root, so returning to it ends the
+        // unit
+        while (next_level > 0 && next < size) {
+                d.read(next);
+                next = d.next;
+                if (!d.abbrev) {
+                        // A null entry ends a sibling list
+                        next_level--;
+                        continue;
+                }
+                if (!filter || d.tag == tag) {
+                        level = next_level;
+                        return;
+                }
+                if (d.abbrev->children)
+                        next_level++;
+        }
+        // Leave d invalid to mark the end
+        d = die();
+}
+
 //////////////////////////////////////////////////////////////////
 // class compilation_unit
 //
 
 compilation_unit::compilation_unit(const dwarf &file, section_offset offset)
+        : compilation_unit(file, offset, 0, 0)
+{
+}
+
+compilation_unit::compilation_unit(const dwarf &file, section_offset offset,
+                                   section_offset abbrev_base,
+                                   section_offset str_offsets_base)
 {
-        // Read the CU header (DWARF4 section 7.5.1.1)
+        // Read the CU header (DWARF4 section 7.5.1.1, DWARF5 section
+        // 7.5.1.1)
         cursor cur(file.get_section(section_type::info), offset);
         std::shared_ptr<section> subsec = cur.subsection();
         cursor sub(subsec);
@@ -293,18 +897,72 @@ compilation_unit::compilation_unit(const dwarf &file, section_offset offset)
         if (version < 2 || version > 5)
                 throw format_error("unknown compilation unit version " + std::to_string(version));
         section_offset debug_abbrev_offset;
+        DW_UT unit_type = DW_UT::compile;
+        uint64_t dwo_id = 0;
         if (version == 5) {
-                sub.fixed<ubyte>(); // unit_type
+                unit_type = (DW_UT)sub.fixed<ubyte>();
                 subsec->addr_size = sub.fixed<ubyte>();
                 debug_abbrev_offset = sub.offset();
+                if (unit_type == DW_UT::skeleton ||
+                    unit_type == DW_UT::split_compile)
+                        dwo_id = sub.fixed<uint64_t>();
         } else {
                 // .debug_abbrev-relative offset of this unit's abbrevs
                 debug_abbrev_offset = sub.offset();
                 subsec->addr_size = sub.fixed<ubyte>();
         }
 
-        m = make_shared<impl>(file, offset, subsec, debug_abbrev_offset,
+        m = make_shared<impl>(file, offset, subsec,
+                              abbrev_base + debug_abbrev_offset,
                               sub.get_section_offset());
+        m->version = version;
+        m->unit_type = unit_type;
+        m->dwo_id = dwo_id;
+        m->str_offsets_base = str_offsets_base;
+}
+
+bool
+compilation_unit::is_skeleton() const
+{
+        if (m->version >= 5)
+                return m->unit_type == DW_UT::skeleton;
+        return root().has(DW_AT::GNU_dwo_name);
+}
+
+uint64_t
+compilation_unit::get_dwo_id() const
+{
+        if (m->version >= 5)
+                return m->dwo_id;
+        // GCC's DWARF 4 extension puts the ID in both root DIEs
+        const die &d = root();
+        if (!d.has(DW_AT::GNU_dwo_id))
+                return 0;
+        return d[DW_AT::GNU_dwo_id].as_uconstant();
+}
+
+const compilation_unit &
+compilation_unit::get_split_unit() const
+{
+        if (m->split.valid() || !is_skeleton())
+                return m->split;
+
+        const die &d = root();
+        string path = d.has(DW_AT::dwo_name) ?
+                d[DW_AT::dwo_name].as_string() :
+                d[DW_AT::GNU_dwo_name].as_string();
+        if (!path.empty() && path[0] != '/')
+                path = comp_dir() + path;
+
+        compilation_unit split = m->file.find_split_unit(get_dwo_id(), path);
+        // The split unit's indexed addresses are in this unit's
+        // part of .debug_addr
+        m->force_addr_base(d);
+        split.m->addr_file = m->addr_file;
+        split.m->addr_base = m->addr_base;
+        split.m->have_addr_base = true;
+        m->split = split;
+        return m->split;
 }
 
 const line_table &
@@ -312,7 +970,9 @@ compilation_unit::get_line_table() const
 {
         if (!m->lt.valid()) {
                 const die &d = root();
-                if (!d.has(DW_AT::stmt_list) || !d.has(DW_AT::name))
+                // Skeleton units leave their name to the split unit
+                if (!d.has(DW_AT::stmt_list) ||
+                    (!d.has(DW_AT::name) && !is_skeleton()))
                         goto done;
 
                 shared_ptr<section> sec;
@@ -343,6 +1003,17 @@ done:
         return at_name(root());
 }
 
+::std::string_view compilation_unit::comp_dir_view() const
+{
+        const die &d = root();
+        return d.has(DW_AT::comp_dir) ? at_comp_dir_view(d) : "";
+}
+
+::std::string_view compilation_unit::name_view() const
+{
+        return at_name_view(root());
+}
+
 uint8_t compilation_unit::address_size() const
 {
         return m->subsec->addr_size;
@@ -353,25 +1024,46 @@ uint8_t compilation_unit::address_size() const
 //
 
 type_unit::type_unit(const dwarf &file, section_offset offset)
+        : type_unit(file, section_type::types, offset, 0, 0)
 {
-        // Read the type unit header (DWARF4 section 7.5.1.2)
-        cursor cur(file.get_section(section_type::types), offset);
+}
+
+type_unit::type_unit(const dwarf &file, section_type sec,
+                     section_offset offset, section_offset abbrev_base,
+                     section_offset str_offsets_base)
+{
+        // Read the type unit header (DWARF4 section 7.5.1.2, DWARF5
+        // section 7.5.1.3)
+        cursor cur(file.get_section(sec), offset);
         std::shared_ptr<section> subsec = cur.subsection();
         cursor sub(subsec);
         sub.skip_initial_length();
         uhalf version = sub.fixed<uhalf>();
-        if (version != 4)
+        DW_UT unit_type = DW_UT::type;
+        section_offset debug_abbrev_offset;
+        if (version == 5) {
+                unit_type = (DW_UT)sub.fixed<ubyte>();
+                if (unit_type != DW_UT::type && unit_type != DW_UT::split_type)
+                        throw format_error("not a type unit: " + to_string(unit_type));
+                subsec->addr_size = sub.fixed<ubyte>();
+                debug_abbrev_offset = sub.offset();
+        } else if (version == 4) {
+                // .debug_abbrev-relative offset of this unit's abbrevs
+                debug_abbrev_offset = sub.offset();
+                subsec->addr_size = sub.fixed<ubyte>();
+        } else {
                 throw format_error("unknown type unit version " + std::to_string(version));
-        // .debug_abbrev-relative offset of this unit's abbrevs
-        section_offset debug_abbrev_offset = sub.offset();
-        ubyte address_size = sub.fixed<ubyte>();
-        subsec->addr_size = address_size;
+        }
         uint64_t type_signature = sub.fixed<uint64_t>();
         section_offset type_offset = sub.offset();
 
-        m = make_shared<impl>(file, offset, subsec, debug_abbrev_offset,
+        m = make_shared<impl>(file, offset, subsec,
+                              abbrev_base + debug_abbrev_offset,
                               sub.get_section_offset(), type_signature,
                               type_offset);
+        m->version = version;
+        m->unit_type = unit_type;
+        m->str_offsets_base = str_offsets_base;
 }
 
 uint64_t
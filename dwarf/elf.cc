@@ -28,6 +28,12 @@ static const struct
         {".debug_str",      section_type::str},
         {".debug_types",    section_type::types},
         {".debug_line_str", section_type::line_str},
+        {".debug_str_offsets", section_type::str_offsets},
+        {".debug_addr",     section_type::addr},
+        {".debug_loclists", section_type::loclists},
+        {".debug_rnglists", section_type::rnglists},
+        {".debug_cu_index", section_type::cu_index},
+        {".debug_tu_index", section_type::tu_index},
 };
 
 bool
@@ -52,4 +58,30 @@ elf::section_type_to_name(section_type type)
         return nullptr;
 }
 
+unsigned
+elf::frame_pointer_regno(unsigned machine)
+{
+        // ELF e_machine values and the psABI DWARF register numbers
+        // of each machine's frame pointer.
+        switch (machine) {
+        case 3:                 // EM_386: %ebp
+                return 5;
+        case 20:                // EM_PPC: r31
+        case 21:                // EM_PPC64: r31
+                return 31;
+        case 22:                // EM_S390: %r11
+                return 11;
+        case 40:                // EM_ARM: r11
+                return 11;
+        case 62:                // EM_X86_64: %rbp
+                return 6;
+        case 183:               // EM_AARCH64: x29
+                return 29;
+        case 243:               // EM_RISCV: s0
+                return 8;
+        default:
+                return cfi_data::no_register;
+        }
+}
+
 DWARFPP_END_NAMESPACE
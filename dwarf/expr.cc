@@ -4,6 +4,8 @@
 
 #include "internal.hh"
 
+#include <algorithm>
+
 using namespace std;
 
 DWARFPP_BEGIN_NAMESPACE
@@ -28,23 +30,10 @@ expr::evaluate(expr_context *ctx, taddr argument) const
         return evaluate(ctx, {argument});
 }
 
-expr_result
-expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments) const
+expr_program::expr_program(const unit *cu,
+                           section_offset offset, section_length len)
+        : shape(expr_shape::general)
 {
-        // The stack machine's stack.  The top of the stack is
-        // stack.back().
-        // XXX This stack must be in target machine representation,
-        // since I see both (DW_OP_breg0 (eax): -28; DW_OP_stack_value)
-        // and (DW_OP_lit1; DW_OP_stack_value).
-        small_vector<taddr, 8> stack;
-
-        // Create the initial stack.  arguments are in reverse order
-        // (that is, element 0 is TOS), so reverse it.
-        stack.reserve(arguments.size());
-        for (const taddr *elt = arguments.end() - 1;
-             elt >= arguments.begin(); elt--)
-                stack.push_back(*elt);
-
         // Create a subsection for just this expression so we can
         // easily detect the end (including premature end).
         auto cusec = cu->data();
@@ -54,25 +43,315 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                                       cusec->ord, cusec->fmt,
                                       cusec->addr_size));
         cursor cur(subsec);
+        addr_size = subsec->addr_size;
+
+        // The offset of each operation, used to resolve branch
+        // targets.  If decoding fails, the last entry is the offset
+        // of the operation that failed.
+        vector<section_offset> op_offsets;
+        // Branches and their byte offset targets
+        vector<pair<size_t, int64_t> > branches;
+
+        try {
+                while (!cur.end()) {
+                        // Tell GCC to warn us about missing switch
+                        // cases, even though we have a default case.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wswitch-enum"
+                        op_offsets.push_back(cur.get_section_offset());
+                        DW_OP op = (DW_OP)cur.fixed<ubyte>();
+                        expr_op eop{op, 0, 0};
+                        switch (op) {
+                                // 2.5.1.1 Literal encodings
+                        case DW_OP::lit0...DW_OP::lit31:
+                                eop.op = DW_OP::constu;
+                                eop.a = (unsigned)op - (unsigned)DW_OP::lit0;
+                                break;
+                        case DW_OP::addr:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.address();
+                                break;
+                        case DW_OP::const1u:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.fixed<uint8_t>();
+                                break;
+                        case DW_OP::const2u:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.fixed<uint16_t>();
+                                break;
+                        case DW_OP::const4u:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.fixed<uint32_t>();
+                                break;
+                        case DW_OP::const8u:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.fixed<uint64_t>();
+                                break;
+                        case DW_OP::const1s:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.fixed<int8_t>();
+                                break;
+                        case DW_OP::const2s:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.fixed<int16_t>();
+                                break;
+                        case DW_OP::const4s:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.fixed<int32_t>();
+                                break;
+                        case DW_OP::const8s:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.fixed<int64_t>();
+                                break;
+                        case DW_OP::constu:
+                                eop.a = cur.uleb128();
+                                break;
+                        case DW_OP::consts:
+                                eop.op = DW_OP::constu;
+                                eop.a = cur.sleb128();
+                                break;
+
+                                // 2.5.1.2 Register based addressing
+                        case DW_OP::fbreg:
+                                eop.b = cur.sleb128();
+                                break;
+                        case DW_OP::breg0...DW_OP::breg31:
+                                eop.op = DW_OP::bregx;
+                                eop.a = (unsigned)op - (unsigned)DW_OP::breg0;
+                                eop.b = cur.sleb128();
+                                break;
+                        case DW_OP::bregx:
+                                eop.a = cur.uleb128();
+                                eop.b = cur.sleb128();
+                                break;
+
+                                // 2.5.1.3 Stack operations
+                        case DW_OP::dup:
+                        case DW_OP::drop:
+                        case DW_OP::over:
+                        case DW_OP::swap:
+                        case DW_OP::rot:
+                                break;
+                        case DW_OP::pick:
+                                eop.a = cur.fixed<uint8_t>();
+                                break;
+                        case DW_OP::deref:
+                                eop.op = DW_OP::deref_size;
+                                eop.a = addr_size;
+                                break;
+                        case DW_OP::deref_size:
+                                eop.a = cur.fixed<uint8_t>();
+                                break;
+                        case DW_OP::xderef:
+                                eop.op = DW_OP::xderef_size;
+                                eop.a = addr_size;
+                                break;
+                        case DW_OP::xderef_size:
+                                eop.a = cur.fixed<uint8_t>();
+                                break;
+                        case DW_OP::push_object_address:
+                        case DW_OP::form_tls_address:
+                        case DW_OP::call_frame_cfa:
+                                break;
+
+                                // 2.5.1.4 Arithmetic and logical operations
+                        case DW_OP::abs:
+                        case DW_OP::and_:
+                        case DW_OP::div:
+                        case DW_OP::minus:
+                        case DW_OP::mod:
+                        case DW_OP::mul:
+                        case DW_OP::neg:
+                        case DW_OP::not_:
+                        case DW_OP::or_:
+                        case DW_OP::plus:
+                        case DW_OP::shl:
+                        case DW_OP::shr:
+                        case DW_OP::shra:
+                        case DW_OP::xor_:
+                                break;
+                        case DW_OP::plus_uconst:
+                                eop.a = cur.uleb128();
+                                break;
+
+                                // 2.5.1.5 Control flow operations
+                        case DW_OP::le:
+                        case DW_OP::ge:
+                        case DW_OP::eq:
+                        case DW_OP::lt:
+                        case DW_OP::gt:
+                        case DW_OP::ne:
+                                break;
+                        case DW_OP::skip:
+                        case DW_OP::bra:
+                                eop.b = cur.fixed<int16_t>();
+                                branches.emplace_back(
+                                        ops.size(),
+                                        (int64_t)cur.get_section_offset() + eop.b);
+                                break;
+                        case DW_OP::call2:
+                                eop.a = cur.fixed<uint16_t>();
+                                break;
+                        case DW_OP::call4:
+                                eop.a = cur.fixed<uint32_t>();
+                                break;
+                        case DW_OP::call_ref:
+                                eop.a = cur.offset();
+                                break;
+
+                                // 2.5.1.6 Special operations
+                        case DW_OP::nop:
+                                break;
+
+                                // 2.6.1.1.2 Register location descriptions
+                        case DW_OP::reg0...DW_OP::reg31:
+                                eop.op = DW_OP::regx;
+                                eop.a = (unsigned)op - (unsigned)DW_OP::reg0;
+                                break;
+                        case DW_OP::regx:
+                                eop.a = cur.uleb128();
+                                break;
+
+                                // 2.6.1.1.3 Implicit location descriptions
+                        case DW_OP::implicit_value:
+                                eop.a = cur.uleb128();
+                                if (eop.a)
+                                        cur.ensure(eop.a);
+                                eop.b = offset + cur.get_section_offset();
+                                cur += eop.a;
+                                break;
+                        case DW_OP::stack_value:
+                                break;
+
+                                // 2.6.1.2 Composite location descriptions
+                        case DW_OP::piece:
+                                eop.a = cur.uleb128();
+                                break;
+                        case DW_OP::bit_piece:
+                                eop.a = cur.uleb128();
+                                eop.b = cur.uleb128();
+                                break;
+
+                        case DW_OP::lo_user...DW_OP::hi_user:
+                                // XXX We could let the context evaluate this,
+                                // but it would need access to the cursor.
+                                throw expr_error("unknown user op " + to_string(op));
+
+                        default:
+                                throw expr_error("bad operation " + to_string(op));
+                        }
+#pragma GCC diagnostic pop
+                        ops.push_back(eop);
+                }
+                op_offsets.push_back(cur.get_section_offset());
+        } catch (...) {
+                // Report this if evaluation gets this far
+                error = current_exception();
+        }
+
+        // Resolve branch targets to operation indexes
+        for (auto &br : branches) {
+                uint64_t &target = ops[br.first].a;
+                if (br.second >= (int64_t)len && !error) {
+                        target = past_end;
+                        continue;
+                }
+                auto it = lower_bound(op_offsets.begin(), op_offsets.end(),
+                                      br.second);
+                if (br.second < 0 || it == op_offsets.end() ||
+                    (int64_t)*it != br.second)
+                        target = bad_target;
+                else
+                        target = it - op_offsets.begin();
+        }
+
+        // Recognize the common cases
+        if (error)
+                return;
+        if (ops.empty()) {
+                shape = expr_shape::empty;
+        } else if (ops.size() == 1) {
+                switch (ops[0].op) {
+                case DW_OP::constu:
+                        shape = expr_shape::constant;
+                        break;
+                case DW_OP::bregx:
+                        shape = expr_shape::breg;
+                        break;
+                case DW_OP::fbreg:
+                        shape = expr_shape::fbreg;
+                        break;
+                case DW_OP::regx:
+                        shape = expr_shape::reg;
+                        break;
+                case DW_OP::plus_uconst:
+                        shape = expr_shape::plus_uconst;
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
+expr_result
+expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments) const
+{
+        const expr_program &prog = cu->get_expr(offset, len);
+        const expr_op *ops = prog.ops.data();
 
         // Prepare the expression result.  Some location descriptions
         // create the result directly, rather than using the top of
-        // stack.
+        // stack.  Assume the result is an address for now and should
+        // be grabbed from the top of stack at the end.
         expr_result result;
+        result.location_type = expr_result::type::address;
 
-        // 2.6.1.1.4 Empty location descriptions
-        if (cur.end()) {
+        // Evaluate the common cases directly
+        switch (prog.shape) {
+        case expr_shape::general:
+                break;
+        case expr_shape::empty:
+                // 2.6.1.1.4 Empty location descriptions
                 result.location_type = expr_result::type::empty;
                 result.value = 0;
                 return result;
+        case expr_shape::constant:
+                result.value = ops[0].a;
+                return result;
+        case expr_shape::breg:
+                result.value = (int64_t)ctx->reg(ops[0].a) + ops[0].b;
+                return result;
+        case expr_shape::fbreg:
+                result.value = (int64_t)ctx->frame_base() + ops[0].b;
+                return result;
+        case expr_shape::reg:
+                result.location_type = expr_result::type::reg;
+                result.value = ops[0].a;
+                return result;
+        case expr_shape::plus_uconst:
+                if (arguments.size() == 0)
+                        goto underflow;
+                result.value = *arguments.begin() + ops[0].a;
+                return result;
         }
 
-        // Assume the result is an address for now and should be
-        // grabbed from the top of stack at the end.
-        result.location_type = expr_result::type::address;
+        {
+        // The stack machine's stack.  The top of the stack is
+        // stack.back().
+        // XXX This stack must be in target machine representation,
+        // since I see both (DW_OP_breg0 (eax): -28; DW_OP_stack_value)
+        // and (DW_OP_lit1; DW_OP_stack_value).
+        small_vector<taddr, 8> stack;
+
+        // Create the initial stack.  arguments are in reverse order
+        // (that is, element 0 is TOS), so reverse it.
+        stack.reserve(arguments.size());
+        for (size_t i = arguments.size(); i-- > 0; )
+                stack.push_back(arguments.begin()[i]);
 
         // Execute!
-        while (!cur.end()) {
+        uint64_t pc = 0, nops = prog.ops.size();
+        while (pc < nops) {
 #define CHECK() do { if (stack.empty()) goto underflow; } while (0)
 #define CHECKN(n) do { if (stack.size() < n) goto underflow; } while (0)
                 union
@@ -82,63 +361,19 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                 } tmp1, tmp2, tmp3;
                 static_assert(sizeof(tmp1) == sizeof(taddr), "taddr is not 64 bits");
 
-                // Tell GCC to warn us about missing switch cases,
-                // even though we have a default case.
-#pragma GCC diagnostic push
-#pragma GCC diagnostic warning "-Wswitch-enum"
-                DW_OP op = (DW_OP)cur.fixed<ubyte>();
-                switch (op) {
+                const expr_op &op = ops[pc++];
+                switch (op.op) {
                         // 2.5.1.1 Literal encodings
-                case DW_OP::lit0...DW_OP::lit31:
-                        stack.push_back((unsigned)op - (unsigned)DW_OP::lit0);
-                        break;
-                case DW_OP::addr:
-                        stack.push_back(cur.address());
-                        break;
-                case DW_OP::const1u:
-                        stack.push_back(cur.fixed<uint8_t>());
-                        break;
-                case DW_OP::const2u:
-                        stack.push_back(cur.fixed<uint16_t>());
-                        break;
-                case DW_OP::const4u:
-                        stack.push_back(cur.fixed<uint32_t>());
-                        break;
-                case DW_OP::const8u:
-                        stack.push_back(cur.fixed<uint64_t>());
-                        break;
-                case DW_OP::const1s:
-                        stack.push_back(cur.fixed<int8_t>());
-                        break;
-                case DW_OP::const2s:
-                        stack.push_back(cur.fixed<int16_t>());
-                        break;
-                case DW_OP::const4s:
-                        stack.push_back(cur.fixed<int32_t>());
-                        break;
-                case DW_OP::const8s:
-                        stack.push_back(cur.fixed<int64_t>());
-                        break;
                 case DW_OP::constu:
-                        stack.push_back(cur.uleb128());
-                        break;
-                case DW_OP::consts:
-                        stack.push_back(cur.sleb128());
+                        stack.push_back(op.a);
                         break;
 
                         // 2.5.1.2 Register based addressing
                 case DW_OP::fbreg:
-                        // XXX
-                        throw runtime_error("DW_OP_fbreg not implemented");
-                case DW_OP::breg0...DW_OP::breg31:
-                        tmp1.u = (unsigned)op - (unsigned)DW_OP::breg0;
-                        tmp2.s = cur.sleb128();
-                        stack.push_back((int64_t)ctx->reg(tmp1.u) + tmp2.s);
+                        stack.push_back((int64_t)ctx->frame_base() + op.b);
                         break;
                 case DW_OP::bregx:
-                        tmp1.u = cur.uleb128();
-                        tmp2.s = cur.sleb128();
-                        stack.push_back((int64_t)ctx->reg(tmp1.u) + tmp2.s);
+                        stack.push_back((int64_t)ctx->reg(op.a) + op.b);
                         break;
 
                         // 2.5.1.3 Stack operations
@@ -151,9 +386,8 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                         stack.pop_back();
                         break;
                 case DW_OP::pick:
-                        tmp1.u = cur.fixed<uint8_t>();
-                        CHECKN(tmp1.u);
-                        stack.push_back(stack.revat(tmp1.u));
+                        CHECKN(op.a + 1);
+                        stack.push_back(stack.revat(op.a));
                         break;
                 case DW_OP::over:
                         CHECKN(2);
@@ -172,29 +406,19 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                         stack.revat(1) = stack.revat(2);
                         stack.revat(2) = tmp1.u;
                         break;
-                case DW_OP::deref:
-                        tmp1.u = subsec->addr_size;
-                        goto deref_common;
                 case DW_OP::deref_size:
-                        tmp1.u = cur.fixed<uint8_t>();
-                        if (tmp1.u > subsec->addr_size)
+                        if (op.a > prog.addr_size)
                                 throw expr_error("DW_OP_deref_size operand exceeds address size");
-                deref_common:
                         CHECK();
-                        stack.back() = ctx->deref_size(stack.back(), tmp1.u);
+                        stack.back() = ctx->deref_size(stack.back(), op.a);
                         break;
-                case DW_OP::xderef:
-                        tmp1.u = subsec->addr_size;
-                        goto xderef_common;
                 case DW_OP::xderef_size:
-                        tmp1.u = cur.fixed<uint8_t>();
-                        if (tmp1.u > subsec->addr_size)
+                        if (op.a > prog.addr_size)
                                 throw expr_error("DW_OP_xderef_size operand exceeds address size");
-                xderef_common:
                         CHECKN(2);
                         tmp2.u = stack.back();
                         stack.pop_back();
-                        stack.back() = ctx->xderef_size(tmp2.u, stack.back(), tmp1.u);
+                        stack.back() = ctx->xderef_size(tmp2.u, stack.back(), op.a);
                         break;
                 case DW_OP::push_object_address:
                         // XXX
@@ -227,17 +451,23 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                         UBINOP(&);
                         break;
                 case DW_OP::div:
+                        // The second entry divided by the top entry
                         CHECKN(2);
                         tmp1.u = stack.back();
                         stack.pop_back();
                         tmp2.u = stack.back();
-                        tmp3.s = tmp1.s / tmp2.s;
+                        if (tmp1.s == 0)
+                                throw expr_error("division by zero in DWARF expression");
+                        tmp3.s = tmp2.s / tmp1.s;
                         stack.back() = tmp3.u;
                         break;
                 case DW_OP::minus:
                         UBINOP(-);
                         break;
                 case DW_OP::mod:
+                        CHECKN(2);
+                        if (stack.back() == 0)
+                                throw expr_error("division by zero in DWARF expression");
                         UBINOP(%);
                         break;
                 case DW_OP::mul:
@@ -260,9 +490,8 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                         UBINOP(+);
                         break;
                 case DW_OP::plus_uconst:
-                        tmp1.u = cur.uleb128();
                         CHECK();
-                        stack.back() += tmp1.u;
+                        stack.back() += op.a;
                         break;
                 case DW_OP::shl:
                         CHECKN(2);
@@ -320,7 +549,7 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                                 tmp1.u = stack.back();                  \
                                 stack.pop_back();                       \
                                 tmp2.u = stack.back();                  \
-                                stack.back() = (tmp2.s <= tmp1.s) ? 1 : 0; \
+                                stack.back() = (tmp2.s relop tmp1.s) ? 1 : 0; \
                         } while (0)
                 case DW_OP::le:
                         SRELOP(<=);
@@ -340,46 +569,40 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                 case DW_OP::ne:
                         SRELOP(!=);
                         break;
-                case DW_OP::skip:
-                        tmp1.s = cur.fixed<int16_t>();
-                        goto skip_common;
+#undef SRELOP
                 case DW_OP::bra:
-                        tmp1.s = cur.fixed<int16_t>();
                         CHECK();
-                        tmp2.u = stack.back();
+                        tmp1.u = stack.back();
                         stack.pop_back();
-                        if (tmp2.u == 0)
+                        if (tmp1.u == 0)
                                 break;
-                skip_common:
-                        cur = cursor(subsec, (int64_t)cur.get_section_offset() + tmp1.s);
+                        // Fall through
+                case DW_OP::skip:
+                        if (op.a == expr_program::bad_target)
+                                throw expr_error("branch target is not an operation in DWARF expression");
+                        pc = op.a;
                         break;
                 case DW_OP::call2:
                 case DW_OP::call4:
                 case DW_OP::call_ref:
                         // XXX
-                        throw runtime_error(to_string(op) + " not implemented");
-#undef SRELOP
+                        throw runtime_error(to_string(op.op) + " not implemented");
 
                         // 2.5.1.6 Special operations
                 case DW_OP::nop:
                         break;
 
                         // 2.6.1.1.2 Register location descriptions
-                case DW_OP::reg0...DW_OP::reg31:
-                        result.location_type = expr_result::type::reg;
-                        result.value = (unsigned)op - (unsigned)DW_OP::reg0;
-                        break;
                 case DW_OP::regx:
                         result.location_type = expr_result::type::reg;
-                        result.value = cur.uleb128();
+                        result.value = op.a;
                         break;
 
                         // 2.6.1.1.3 Implicit location descriptions
                 case DW_OP::implicit_value:
                         result.location_type = expr_result::type::implicit;
-                        result.implicit_len = cur.uleb128();
-                        cur.ensure(result.implicit_len);
-                        result.implicit = cur.pos;
+                        result.implicit_len = op.a;
+                        result.implicit = cu->data()->begin + op.b;
                         break;
                 case DW_OP::stack_value:
                         CHECK();
@@ -391,21 +614,21 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                 case DW_OP::piece:
                 case DW_OP::bit_piece:
                         // XXX
-                        throw runtime_error(to_string(op) + " not implemented");
-
-                case DW_OP::lo_user...DW_OP::hi_user:
-                        // XXX We could let the context evaluate this,
-                        // but it would need access to the cursor.
-                        throw expr_error("unknown user op " + to_string(op));
+                        throw runtime_error(to_string(op.op) + " not implemented");
 
                 default:
-                        throw expr_error("bad operation " + to_string(op));
+                        // Every other operation is normalized or
+                        // rejected by expr_program
+                        throw logic_error("unexpected operation " + to_string(op.op));
                 }
-#pragma GCC diagnostic pop
 #undef CHECK
 #undef CHECKN
         }
 
+        // Decoding stopped at this operation
+        if (pc == nops && prog.error)
+                rethrow_exception(prog.error);
+
         if (result.location_type == expr_result::type::address) {
                 // The result type is still and address, so we should
                 // fetch it from the top of stack.
@@ -413,6 +636,7 @@ expr::evaluate(expr_context *ctx, const std::initializer_list<taddr> &arguments)
                         throw expr_error("final stack is empty; no result given");
                 result.value = stack.back();
         }
+        }
 
         return result;
 
@@ -9,6 +9,7 @@
 #include "../elf/to_hex.hh"
 #include "../elf/sig_handler.hh"
 
+#include <exception>
 #include <stdexcept>
 #include <type_traits>
 #include <unordered_map>
@@ -189,6 +190,8 @@ struct cursor
                 case DW_FORM::indirect:
                 case DW_FORM::strx:
                 case DW_FORM::addrx:
+                case DW_FORM::GNU_addr_index:
+                case DW_FORM::GNU_str_index:
                         return uleb128();
                 case DW_FORM::strp:
                 case DW_FORM::sec_offset:
@@ -396,6 +399,91 @@ struct name_entry
         }
 };
 
+/**
+ * A decoded operation in an expr_program.  Literal, register, and
+ * dereference operations are normalized to a single opcode each
+ * (constu, bregx, regx, deref_size, and xderef_size) with their
+ * implied operands made explicit.
+ */
+struct expr_op
+{
+        DW_OP op;
+        // First operand.  For DW_OP_skip and DW_OP_bra, the index of
+        // the target operation.  For DW_OP_implicit_value, the length
+        // of the block.
+        std::uint64_t a;
+        // Second operand.  For DW_OP_bregx and DW_OP_fbreg, the
+        // offset.  For DW_OP_implicit_value, the offset of the block
+        // in the unit.
+        std::int64_t b;
+};
+
+/**
+ * The common shapes of expressions, which are evaluated without
+ * running the interpreter.
+ */
+enum class expr_shape
+{
+        // Anything else
+        general,
+        // No operations
+        empty,
+        // A single literal or DW_OP_addr
+        constant,
+        // A single DW_OP_bregN or DW_OP_bregx
+        breg,
+        // A single DW_OP_fbreg
+        fbreg,
+        // A single DW_OP_regN or DW_OP_regx
+        reg,
+        // A single DW_OP_plus_uconst applied to an argument
+        plus_uconst,
+};
+
+/**
+ * A DWARF expression decoded once into a sequence of operations.
+ * Units cache these by offset, so evaluating an expression again
+ * does not re-read it from the section.
+ */
+struct expr_program
+{
+        // Branch targets that are past the end of the expression and
+        // that are not at the start of an operation
+        static const std::uint64_t past_end = ~(std::uint64_t)0 - 1;
+        static const std::uint64_t bad_target = ~(std::uint64_t)0;
+
+        expr_shape shape;
+        unsigned addr_size;
+        std::vector<expr_op> ops;
+        // If decoding stopped early, the error to throw if evaluation
+        // reaches the end of ops.
+        std::exception_ptr error;
+
+        expr_program(const unit *cu, section_offset offset, section_length len);
+};
+
+/**
+ * Return the size-byte unsigned integer at data, which is big-endian
+ * if msb is true and little-endian otherwise.
+ */
+std::uint64_t read_word(const void *data, unsigned size, bool msb);
+
+/**
+ * Read DWARF register regnum from a Linux user_regs_struct, which is
+ * the layout of the pr_reg field of NT_PRSTATUS and of the
+ * NT_PRSTATUS register set returned by ptrace.  machine is the ELF
+ * e_machine and msb gives the byte order of regs.  Returns false if
+ * the machine or register is not supported.
+ */
+bool user_regs_get(unsigned machine, bool msb, const void *regs,
+                   size_t size, unsigned regnum, taddr *out);
+
+/**
+ * Return the offset of pr_reg in a Linux NT_PRSTATUS descriptor for
+ * the given ELF e_machine, or 0 if the machine is not supported.
+ */
+size_t prstatus_regs_offset(unsigned machine);
+
 DWARFPP_END_NAMESPACE
 
 #endif
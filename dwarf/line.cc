@@ -6,6 +6,7 @@
 #include "../elf/sig_handler.hh"
 
 #include <cassert>
+#include <cstdio>
 #include <string.h>
 
 using namespace std;
@@ -461,8 +462,12 @@ line_table::line_table(const compilation_unit &cu, const shared_ptr<section> &se
                 m->m_files.init(cur, m->m_file_format, m->m_directories);
         } else {
                 auto comp_dir =cu.comp_dir();
+                // File 0 is the unit's name, which line programs before
+                // DWARF 5 never refer to.  Skeleton units leave their
+                // name to the split unit, so use the directory instead.
+                auto name = cu.root().has(DW_AT::name) ? cu.name() : comp_dir;
                 m->m_directories.init(cur, comp_dir);
-                m->m_files.init(cur, comp_dir, cu.name(), m->m_directories);
+                m->m_files.init(cur, comp_dir, name, m->m_directories);
         }
 }
 
@@ -544,6 +549,21 @@ line_table::entry::get_description() const
         return res;
 }
 
+size_t
+line_table::entry::get_description(char *buf, size_t size) const
+{
+        const string &path = file->path();
+        int len;
+        if (line && column)
+                len = snprintf(buf, size, "%s:%u:%u", path.c_str(), line,
+                               column);
+        else if (line)
+                len = snprintf(buf, size, "%s:%u", path.c_str(), line);
+        else
+                len = snprintf(buf, size, "%s", path.c_str());
+        return len < 0 ? 0 : len;
+}
+
 line_table::iterator::iterator(const line_table *table, section_offset pos)
         : table(table), pos(pos)
 {
@@ -0,0 +1,194 @@
+// Copyright (c) 2026 Huawei Technologies Co. All rights reserved.
+// Use of this source code is governed by an MIT license
+// that can be found in the LICENSE file.
+
+#include "internal.hh"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace std;
+
+DWARFPP_BEGIN_NAMESPACE
+
+// The ELF e_machine of this host, for interpreting register sets
+#if defined(__x86_64__)
+static const unsigned host_machine = 62;
+#elif defined(__i386__)
+static const unsigned host_machine = 3;
+#elif defined(__aarch64__)
+static const unsigned host_machine = 183;
+#else
+static const unsigned host_machine = 0;
+#endif
+
+static const bool host_msb = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+
+struct process_context::impl
+{
+        // The number of cached pages.  The cache is direct-mapped by
+        // page number.
+        static constexpr size_t cache_pages = 64;
+        // A tag that never matches a page address
+        static constexpr taddr no_page = 1;
+
+        const pid_t pid;
+        const size_t page_size;
+        unique_ptr<char[]> pages;
+        taddr tags[cache_pages];
+
+        // Cached NT_PRSTATUS register set
+        bool have_regs;
+        size_t regs_size;
+        alignas(8) char regs[1024];
+
+        impl(pid_t pid)
+                : pid(pid), page_size(sysconf(_SC_PAGESIZE)),
+                  pages(new char[cache_pages * page_size]),
+                  have_regs(false)
+        {
+                fill(begin(tags), end(tags), no_page);
+        }
+
+        size_t slot(taddr page) const
+        {
+                return (page / page_size) % cache_pages;
+        }
+
+        /**
+         * Return the cached data of the page at address page, or
+         * nullptr.
+         */
+        const char *lookup(taddr page) const
+        {
+                size_t s = slot(page);
+                if (tags[s] != page)
+                        return nullptr;
+                return &pages[s * page_size];
+        }
+
+        /**
+         * Read the uncached pages among the npages pages starting at
+         * page with one process_vm_readv call.
+         */
+        void fetch(taddr page, size_t npages);
+};
+
+void
+process_context::impl::fetch(taddr page, size_t npages)
+{
+        // More pages than this would collide in the cache
+        npages = min(npages, cache_pages);
+
+        struct iovec local[cache_pages], remote[cache_pages];
+        size_t slots[cache_pages];
+        size_t n = 0;
+        for (size_t i = 0; i < npages; i++, page += page_size) {
+                if (lookup(page))
+                        continue;
+                size_t s = slot(page);
+                // Whatever was in this slot is about to be overwritten
+                tags[s] = no_page;
+                local[n].iov_base = &pages[s * page_size];
+                local[n].iov_len = page_size;
+                remote[n].iov_base = (void*)page;
+                remote[n].iov_len = page_size;
+                slots[n] = s;
+                n++;
+        }
+        if (n == 0)
+                return;
+
+        // Partial reads stop at an iovec boundary, so every page up
+        // to the returned length was read in full.
+        ssize_t got = process_vm_readv(pid, local, n, remote, n, 0);
+        if (got <= 0)
+                return;
+        for (size_t i = 0; i < (size_t)got / page_size; i++)
+                tags[slots[i]] = (taddr)remote[i].iov_base;
+}
+
+process_context::process_context(pid_t pid)
+        : m(make_shared<impl>(pid))
+{
+}
+
+void
+process_context::invalidate()
+{
+        fill(begin(m->tags), end(m->tags), impl::no_page);
+        m->have_regs = false;
+}
+
+void
+process_context::prefetch(taddr address, size_t size)
+{
+        if (size == 0)
+                return;
+        taddr first = address & ~(taddr)(m->page_size - 1);
+        taddr last = (address + size - 1) & ~(taddr)(m->page_size - 1);
+        m->fetch(first, (last - first) / m->page_size + 1);
+}
+
+bool
+process_context::read(taddr address, void *buf, size_t size)
+{
+        char *out = (char*)buf;
+        while (size) {
+                taddr page = address & ~(taddr)(m->page_size - 1);
+                const char *data = m->lookup(page);
+                if (!data) {
+                        // Fetch the rest of the read at once
+                        prefetch(address, size);
+                        data = m->lookup(page);
+                        if (!data)
+                                return false;
+                }
+                size_t off = address - page;
+                size_t n = min(size, m->page_size - off);
+                memcpy(out, data + off, n);
+                out += n;
+                address += n;
+                size -= n;
+        }
+        return true;
+}
+
+taddr
+process_context::reg(unsigned regnum)
+{
+        if (!m->have_regs) {
+                struct iovec iov = {m->regs, sizeof(m->regs)};
+                // NT_PRSTATUS is 1
+                if (ptrace(PTRACE_GETREGSET, m->pid, (void*)1, &iov) < 0)
+                        throw expr_error("cannot read registers of process " +
+                                         std::to_string(m->pid) + ": " +
+                                         strerror(errno));
+                m->regs_size = iov.iov_len;
+                m->have_regs = true;
+        }
+        taddr val;
+        if (!user_regs_get(host_machine, host_msb, m->regs, m->regs_size,
+                           regnum, &val))
+                throw expr_error("register " + std::to_string(regnum) +
+                                 " not available");
+        return val;
+}
+
+taddr
+process_context::deref_size(taddr address, unsigned size)
+{
+        if (size > sizeof(taddr))
+                throw expr_error("DW_OP_deref_size operand exceeds address size");
+        char buf[sizeof(taddr)];
+        if (!read(address, buf, size))
+                throw expr_error("cannot read address 0x" + to_hex(address) +
+                                 " in process " + std::to_string(m->pid));
+        return read_word(buf, size, host_msb);
+}
+
+DWARFPP_END_NAMESPACE
@@ -21,10 +21,29 @@ to_string(section_type v)
         case section_type::ranges: return "section_type::ranges";
         case section_type::str: return "section_type::str";
         case section_type::types: return "section_type::types";
+        case section_type::line_str: return "section_type::line_str";
+        case section_type::str_offsets: return "section_type::str_offsets";
+        case section_type::addr: return "section_type::addr";
+        case section_type::loclists: return "section_type::loclists";
+        case section_type::rnglists: return "section_type::rnglists";
+        case section_type::cu_index: return "section_type::cu_index";
+        case section_type::tu_index: return "section_type::tu_index";
         }
         return "(section_type)" + std::to_string((int)v);
 }
 
+std::string
+to_string(access_pattern v)
+{
+        switch (v) {
+        case access_pattern::normal: return "access_pattern::normal";
+        case access_pattern::sequential: return "access_pattern::sequential";
+        case access_pattern::random: return "access_pattern::random";
+        case access_pattern::willneed: return "access_pattern::willneed";
+        }
+        return "(access_pattern)" + std::to_string((int)v);
+}
+
 std::string
 to_string(value::type v)
 {
@@ -60,6 +79,34 @@ to_string(expr_result::type v)
         return "(expr_result::type)" + std::to_string((int)v);
 }
 
+std::string
+to_string(unwind_rule_type v)
+{
+        switch (v) {
+        case unwind_rule_type::undefined: return "unwind_rule_type::undefined";
+        case unwind_rule_type::same_value: return "unwind_rule_type::same_value";
+        case unwind_rule_type::offset: return "unwind_rule_type::offset";
+        case unwind_rule_type::val_offset: return "unwind_rule_type::val_offset";
+        case unwind_rule_type::reg: return "unwind_rule_type::reg";
+        case unwind_rule_type::expression: return "unwind_rule_type::expression";
+        }
+        return "(unwind_rule_type)" + std::to_string((int)v);
+}
+
+std::string
+to_string(DW_UT v)
+{
+        switch (v) {
+        case DW_UT::compile: return "DW_UT_compile";
+        case DW_UT::type: return "DW_UT_type";
+        case DW_UT::partial: return "DW_UT_partial";
+        case DW_UT::skeleton: return "DW_UT_skeleton";
+        case DW_UT::split_compile: return "DW_UT_split_compile";
+        case DW_UT::split_type: return "DW_UT_split_type";
+        }
+        return "(DW_UT)0x" + to_hex((int)v);
+}
+
 std::string
 to_string(DW_TAG v)
 {
@@ -124,6 +171,14 @@ to_string(DW_TAG v)
         case DW_TAG::type_unit: return "DW_TAG_type_unit";
         case DW_TAG::rvalue_reference_type: return "DW_TAG_rvalue_reference_type";
         case DW_TAG::template_alias: return "DW_TAG_template_alias";
+        case DW_TAG::coarray_type: return "DW_TAG_coarray_type";
+        case DW_TAG::generic_subrange: return "DW_TAG_generic_subrange";
+        case DW_TAG::dynamic_type: return "DW_TAG_dynamic_type";
+        case DW_TAG::atomic_type: return "DW_TAG_atomic_type";
+        case DW_TAG::call_site: return "DW_TAG_call_site";
+        case DW_TAG::call_site_parameter: return "DW_TAG_call_site_parameter";
+        case DW_TAG::skeleton_unit: return "DW_TAG_skeleton_unit";
+        case DW_TAG::immutable_type: return "DW_TAG_immutable_type";
         case DW_TAG::lo_user: break;
         case DW_TAG::hi_user: break;
         }
@@ -236,7 +291,40 @@ to_string(DW_AT v)
         case DW_AT::const_expr: return "DW_AT_const_expr";
         case DW_AT::enum_class: return "DW_AT_enum_class";
         case DW_AT::linkage_name: return "DW_AT_linkage_name";
+        case DW_AT::string_length_bit_size: return "DW_AT_string_length_bit_size";
+        case DW_AT::string_length_byte_size: return "DW_AT_string_length_byte_size";
+        case DW_AT::rank: return "DW_AT_rank";
+        case DW_AT::str_offsets_base: return "DW_AT_str_offsets_base";
+        case DW_AT::addr_base: return "DW_AT_addr_base";
+        case DW_AT::rnglists_base: return "DW_AT_rnglists_base";
+        case DW_AT::dwo_name: return "DW_AT_dwo_name";
+        case DW_AT::reference: return "DW_AT_reference";
+        case DW_AT::rvalue_reference: return "DW_AT_rvalue_reference";
+        case DW_AT::macros: return "DW_AT_macros";
+        case DW_AT::call_all_calls: return "DW_AT_call_all_calls";
+        case DW_AT::call_all_source_calls: return "DW_AT_call_all_source_calls";
+        case DW_AT::call_all_tail_calls: return "DW_AT_call_all_tail_calls";
+        case DW_AT::call_return_pc: return "DW_AT_call_return_pc";
+        case DW_AT::call_value: return "DW_AT_call_value";
+        case DW_AT::call_origin: return "DW_AT_call_origin";
+        case DW_AT::call_parameter: return "DW_AT_call_parameter";
+        case DW_AT::call_pc: return "DW_AT_call_pc";
+        case DW_AT::call_tail_call: return "DW_AT_call_tail_call";
+        case DW_AT::call_target: return "DW_AT_call_target";
+        case DW_AT::call_target_clobbered: return "DW_AT_call_target_clobbered";
+        case DW_AT::call_data_location: return "DW_AT_call_data_location";
+        case DW_AT::call_data_value: return "DW_AT_call_data_value";
+        case DW_AT::noreturn: return "DW_AT_noreturn";
+        case DW_AT::alignment: return "DW_AT_alignment";
+        case DW_AT::export_symbols: return "DW_AT_export_symbols";
+        case DW_AT::deleted: return "DW_AT_deleted";
+        case DW_AT::defaulted: return "DW_AT_defaulted";
+        case DW_AT::loclists_base: return "DW_AT_loclists_base";
         case DW_AT::lo_user: break;
+        case DW_AT::GNU_dwo_name: return "DW_AT_GNU_dwo_name";
+        case DW_AT::GNU_dwo_id: return "DW_AT_GNU_dwo_id";
+        case DW_AT::GNU_ranges_base: return "DW_AT_GNU_ranges_base";
+        case DW_AT::GNU_addr_base: return "DW_AT_GNU_addr_base";
         case DW_AT::hi_user: break;
         }
         return "(DW_AT)0x" + to_hex((int)v);
@@ -289,6 +377,8 @@ to_string(DW_FORM v)
         case DW_FORM::addrx2: return "DW_FORM_addrx2";
         case DW_FORM::addrx3: return "DW_FORM_addrx3";
         case DW_FORM::addrx4: return "DW_FORM_addrx4";
+        case DW_FORM::GNU_addr_index: return "DW_FORM_GNU_addr_index";
+        case DW_FORM::GNU_str_index: return "DW_FORM_GNU_str_index";
         }
         return "(DW_FORM)0x" + to_hex((int)v);
 }
@@ -588,4 +678,43 @@ to_string(DW_LNCT v)
         return "(DW_LNCT)0x" + to_hex((int)v);
 }
 
+std::string
+to_string(DW_CFA v)
+{
+        switch (v) {
+        case DW_CFA::advance_loc: return "DW_CFA_advance_loc";
+        case DW_CFA::offset: return "DW_CFA_offset";
+        case DW_CFA::restore: return "DW_CFA_restore";
+        case DW_CFA::nop: return "DW_CFA_nop";
+        case DW_CFA::set_loc: return "DW_CFA_set_loc";
+        case DW_CFA::advance_loc1: return "DW_CFA_advance_loc1";
+        case DW_CFA::advance_loc2: return "DW_CFA_advance_loc2";
+        case DW_CFA::advance_loc4: return "DW_CFA_advance_loc4";
+        case DW_CFA::offset_extended: return "DW_CFA_offset_extended";
+        case DW_CFA::restore_extended: return "DW_CFA_restore_extended";
+        case DW_CFA::undefined: return "DW_CFA_undefined";
+        case DW_CFA::same_value: return "DW_CFA_same_value";
+        case DW_CFA::register_: return "DW_CFA_register";
+        case DW_CFA::remember_state: return "DW_CFA_remember_state";
+        case DW_CFA::restore_state: return "DW_CFA_restore_state";
+        case DW_CFA::def_cfa: return "DW_CFA_def_cfa";
+        case DW_CFA::def_cfa_register: return "DW_CFA_def_cfa_register";
+        case DW_CFA::def_cfa_offset: return "DW_CFA_def_cfa_offset";
+        case DW_CFA::def_cfa_expression: return "DW_CFA_def_cfa_expression";
+        case DW_CFA::expression: return "DW_CFA_expression";
+        case DW_CFA::offset_extended_sf: return "DW_CFA_offset_extended_sf";
+        case DW_CFA::def_cfa_sf: return "DW_CFA_def_cfa_sf";
+        case DW_CFA::def_cfa_offset_sf: return "DW_CFA_def_cfa_offset_sf";
+        case DW_CFA::val_offset: return "DW_CFA_val_offset";
+        case DW_CFA::val_offset_sf: return "DW_CFA_val_offset_sf";
+        case DW_CFA::val_expression: return "DW_CFA_val_expression";
+        case DW_CFA::lo_user: break;
+        case DW_CFA::hi_user: break;
+        case DW_CFA::GNU_window_save: return "DW_CFA_GNU_window_save";
+        case DW_CFA::GNU_args_size: return "DW_CFA_GNU_args_size";
+        case DW_CFA::GNU_negative_offset_extended: return "DW_CFA_GNU_negative_offset_extended";
+        }
+        return "(DW_CFA)0x" + to_hex((int)v);
+}
+
 DWARFPP_END_NAMESPACE
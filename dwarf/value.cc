@@ -12,8 +12,9 @@ using namespace std;
 DWARFPP_BEGIN_NAMESPACE
 
 value::value(const unit *cu,
-             DW_AT name, DW_FORM form, type typ, section_offset offset)
-        : cu(cu), form(form), typ(typ), offset(offset) {
+             DW_AT name, DW_FORM form, type typ, section_offset offset,
+             int64_t implicit)
+        : cu(cu), form(form), typ(typ), offset(offset), implicit(implicit) {
         if (form == DW_FORM::indirect)
                 resolve_indirect(name);
 }
@@ -24,14 +25,52 @@ value::get_section_offset() const
         return cu->get_section_offset() + offset;
 }
 
+/**
+ * Read the index operand of one of the strx or addrx forms.
+ */
+static uint64_t
+read_index(cursor *cur, DW_FORM form)
+{
+        switch (form) {
+        case DW_FORM::strx1:
+        case DW_FORM::addrx1:
+                return cur->fixed<ubyte>();
+        case DW_FORM::strx2:
+        case DW_FORM::addrx2:
+                return cur->fixed<uhalf>();
+        case DW_FORM::strx3:
+        case DW_FORM::addrx3: {
+                uint64_t first = cur->fixed<uhalf>();
+                uint64_t last = cur->fixed<ubyte>();
+                if (cur->sec->ord == byte_order::lsb)
+                        return first | (last << 16);
+                return (first << 8) | last;
+        }
+        case DW_FORM::strx4:
+        case DW_FORM::addrx4:
+                return cur->fixed<uword>();
+        default:
+                return cur->uleb128();
+        }
+}
+
 taddr
 value::as_address() const
 {
-        if (form != DW_FORM::addr)
-                throw value_type_mismatch("cannot read " + to_string(typ) + " as address");
-
         cursor cur(cu->data(), offset);
-        return cur.address();
+        switch (form) {
+        case DW_FORM::addr:
+                return cur.address();
+        case DW_FORM::addrx:
+        case DW_FORM::addrx1:
+        case DW_FORM::addrx2:
+        case DW_FORM::addrx3:
+        case DW_FORM::addrx4:
+        case DW_FORM::GNU_addr_index:
+                return cu->get_addr(read_index(&cur, form));
+        default:
+                throw value_type_mismatch("cannot read " + to_string(typ) + " as address");
+        }
 }
 
 const void *
@@ -65,6 +104,8 @@ value::as_block(size_t *size_out) const
 uint64_t
 value::as_uconstant() const
 {
+        if (form == DW_FORM::implicit_const)
+                return implicit;
         cursor cur(cu->data(), offset);
         switch (form) {
         case DW_FORM::data1:
@@ -76,7 +117,13 @@ value::as_uconstant() const
         case DW_FORM::data8:
                 return cur.fixed<uint64_t>();
         case DW_FORM::udata:
+        case DW_FORM::loclistx:
+        case DW_FORM::rnglistx:
                 return cur.uleb128();
+        case DW_FORM::sec_offset:
+                // The bases of the indexed forms, such as
+                // DW_AT_addr_base
+                return cur.offset();
         default:
                 throw value_type_mismatch("cannot read " + to_string(typ) + " as uconstant");
         }
@@ -85,6 +132,8 @@ value::as_uconstant() const
 int64_t
 value::as_sconstant() const
 {
+        if (form == DW_FORM::implicit_const)
+                return implicit;
         cursor cur(cu->data(), offset);
         switch (form) {
         case DW_FORM::data1:
@@ -167,6 +216,18 @@ value::is_valid_rangelist() const
 
 die
 value::as_reference() const
+{
+        const unit *target;
+        section_offset off;
+        as_reference_location(&target, &off);
+        die d(target);
+        d.read(off);
+        return d;
+}
+
+void
+value::as_reference_location(const unit **target,
+                             section_offset *target_offset) const
 {
         section_offset off;
         // XXX Would be nice if we could avoid this.  The cursor is
@@ -191,24 +252,25 @@ value::as_reference() const
 
         case DW_FORM::ref_addr: {
                 off = cur.offset();
-                // These seem to be extremely rare in practice (I
-                // haven't been able to get gcc to produce a
-                // ref_addr), so it's not worth caching this lookup.
-                const compilation_unit *base_cu = nullptr;
-                for (auto &file_cu : cu->get_dwarf().compilation_units()) {
-                        if (file_cu.get_section_offset() > off)
-                                break;
-                        base_cu = &file_cu;
+                try {
+                        const compilation_unit &base_cu =
+                                cu->get_dwarf().unit_at_offset(off);
+                        *target = &base_cu;
+                        *target_offset = off - base_cu.get_section_offset();
+                        return;
+                } catch (std::out_of_range &e) {
+                        throw format_error("reference to .debug_info offset 0x" +
+                                           to_hex(off) + " is outside any unit");
                 }
-                die d(base_cu);
-                d.read(off - base_cu->get_section_offset());
-                return d;
         }
 
         case DW_FORM::ref_sig8: {
                 uint64_t sig = cur.fixed<uint64_t>();
                 try {
-                        return cu->get_dwarf().get_type_unit(sig).type();
+                        const type_unit &tu = cu->get_dwarf().get_type_unit(sig);
+                        *target = &tu;
+                        *target_offset = tu.type().get_unit_offset();
+                        return;
                 } catch (std::out_of_range &e) {
                         throw format_error("unknown type signature 0x" + to_hex(sig));
                 }
@@ -218,9 +280,8 @@ value::as_reference() const
                 throw value_type_mismatch("cannot read " + to_string(typ) + " as reference");
         }
 
-        die d(cu);
-        d.read(off);
-        return d;
+        *target = cu;
+        *target_offset = off;
 }
 
 void
@@ -257,11 +318,29 @@ value::as_cstr(size_t *size_out) const
                 cursor scur(cu->get_dwarf().get_section(section_type::line_str), off);
                 return scur.cstr(size_out);
         }
+        case DW_FORM::strx:
+        case DW_FORM::strx1:
+        case DW_FORM::strx2:
+        case DW_FORM::strx3:
+        case DW_FORM::strx4:
+        case DW_FORM::GNU_str_index: {
+                section_offset off = cu->get_str_offset(read_index(&cur, form));
+                cursor scur(cu->get_dwarf().get_section(section_type::str), off);
+                return scur.cstr(size_out);
+        }
         default:
                 throw value_type_mismatch("cannot read " + to_string(form) + " " + to_string(typ) + " as string");
         }
 }
 
+string_view
+value::as_string_view() const
+{
+        size_t size;
+        const char *s = as_cstr(&size);
+        return string_view(s, size);
+}
+
 section_offset
 value::as_sec_offset() const
 {
@@ -329,15 +408,20 @@ to_string(const value &v)
         case value::type::line:
                 return "<line 0x" + to_hex(v.as_sec_offset()) + ">";
         case value::type::loclist:
+                if (v.get_form() == DW_FORM::loclistx)
+                        return "<loclist index " + ::to_string(v.as_uconstant()) + ">";
                 return "<loclist 0x" + to_hex(v.as_sec_offset()) + ">";
         case value::type::mac:
                 return "<mac 0x" + to_hex(v.as_sec_offset()) + ">";
         case value::type::rangelist:
+                if (v.get_form() == DW_FORM::rnglistx)
+                        return "<rangelist index " + ::to_string(v.as_uconstant()) + ">";
                 return "<rangelist 0x" + to_hex(v.as_sec_offset()) + ">";
         case value::type::reference: {
                 die d = v.as_reference();
-                auto tu = dynamic_cast<const type_unit*>(&d.get_unit());
-                if (tu)
+                // Offsets are in .debug_info unless the DIE is in a
+                // DWARF 4 type unit
+                if (d.get_unit().data()->type == section_type::types)
                         return "<.debug_types+0x" + to_hex(d.get_section_offset()) + ">";
                 return "<0x" + to_hex(d.get_section_offset()) + ">";
         }
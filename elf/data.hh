@@ -208,6 +208,7 @@ enum class sht : ElfTypes::Word
         shlib    = 10,          // Reserved
         dynsym   = 11,          // Contains a dynamic loader symbol table
         loos     = 0x60000000,  // Environment-specific use
+        gnu_hash = 0x6FFFFFF6,  // Contains a GNU-style symbol hash table
         hios     = 0x6FFFFFFF,
         loproc   = 0x70000000,  // Processor-specific use
         hiproc   = 0x7FFFFFFF,
@@ -225,6 +226,7 @@ enum class shf : Elf64::Xword
         write     = 0x1,        // Section contains writable data
         alloc     = 0x2,        // Section is allocated in memory image of program
         execinstr = 0x4,        // Section contains executable instructions
+        compressed = 0x800,     // Section data is compressed (see Chdr)
         maskos    = 0x0F000000, // Environment-specific use
         maskproc  = 0xF0000000, // Processor-specific use
 };
@@ -309,6 +311,66 @@ struct Shdr
         }
 };
 
+// Compression algorithms (gABI "Compression Headers")
+enum class elfcompress : ElfTypes::Word
+{
+        zlib   = 1,             // ZLIB/DEFLATE
+        zstd   = 2,             // Zstandard
+        loos   = 0x60000000,    // Environment-specific use
+        hios   = 0x6FFFFFFF,
+        loproc = 0x70000000,    // Processor-specific use
+        hiproc = 0x7FFFFFFF,
+};
+
+std::string
+to_string(elfcompress v);
+
+// Compression header (gABI "Compression Headers").  The data of a
+// section with shf::compressed starts with this, followed by the
+// compressed data.
+template<typename E = Elf64, byte_order Order = byte_order::native>
+struct Chdr;
+
+template<byte_order Order>
+struct Chdr<Elf32, Order>
+{
+        typedef Elf32 types;
+        static const byte_order order = Order;
+
+        elfcompress  type;      // Compression algorithm
+        Elf32::Word  size;      // Size of uncompressed data
+        Elf32::Word  addralign; // Alignment of uncompressed data
+
+        template<typename E2>
+        void from(const E2 &o)
+        {
+                type      = swizzle(o.type, o.order, order);
+                size      = swizzle(o.size, o.order, order);
+                addralign = swizzle(o.addralign, o.order, order);
+        }
+};
+
+template<byte_order Order>
+struct Chdr<Elf64, Order>
+{
+        typedef Elf64 types;
+        static const byte_order order = Order;
+
+        elfcompress  type;      // Compression algorithm
+        Elf64::Word  reserved;
+        Elf64::Xword size;      // Size of uncompressed data
+        Elf64::Xword addralign; // Alignment of uncompressed data
+
+        template<typename E2>
+        void from(const E2 &o)
+        {
+                type      = swizzle(o.type, o.order, order);
+                reserved  = 0;
+                size      = swizzle(o.size, o.order, order);
+                addralign = swizzle(o.addralign, o.order, order);
+        }
+};
+
 // Segment types (ELF64 table 16)
 enum class pt : ElfTypes::Word
 {
@@ -441,6 +503,80 @@ struct Phdr<Elf64, Order>
         }
 };
 
+// Note header (ELF32 figure 2-3, ELF64 figure 11).  The layout is
+// the same for both classes.
+template<typename E = Elf64, byte_order Order = byte_order::native>
+struct Nhdr
+{
+        typedef E types;
+        static const byte_order order = Order;
+
+        ElfTypes::Word namesz;  // Size of name, including NUL
+        ElfTypes::Word descsz;  // Size of descriptor
+        ElfTypes::Word type;    // Type of note, interpreted
+                                // according to name
+
+        template<typename E2>
+        void from(const E2 &o)
+        {
+                namesz = swizzle(o.namesz, o.order, order);
+                descsz = swizzle(o.descsz, o.order, order);
+                type   = swizzle(o.type, o.order, order);
+        }
+};
+
+// Core file note types (note name "CORE")
+enum class nt : ElfTypes::Word
+{
+        prstatus   = 1,           // Thread status and registers
+        prfpreg    = 2,           // Floating point registers
+        prpsinfo   = 3,           // Process information
+        taskstruct = 4,           // Task structure
+        auxv       = 6,           // Auxiliary vector
+        siginfo    = 0x53494749,  // Signal information
+        file       = 0x46494c45,  // Mapped files
+};
+
+std::string
+to_string(nt v);
+
+// Note types for notes named "GNU"
+enum class nt_gnu : ElfTypes::Word
+{
+        abi_tag         = 1,    // ABI information
+        hwcap           = 2,    // Synthetic hwcap information
+        build_id        = 3,    // Unique build ID bitstring
+        gold_version    = 4,    // Version of gold that built the file
+        property_type_0 = 5,    // Program properties
+};
+
+std::string
+to_string(nt_gnu v);
+
+// GNU symbol hash table header.  This is followed by bloom_size Addr
+// bloom filter words, nbuckets Word buckets, and a Word hash chain
+// entry for each symbol from symoffset on.
+template<typename E = Elf64, byte_order Order = byte_order::native>
+struct GnuHash
+{
+        typedef E types;
+        static const byte_order order = Order;
+
+        ElfTypes::Word nbuckets;        // Number of buckets
+        ElfTypes::Word symoffset;       // Index of first hashed symbol
+        ElfTypes::Word bloom_size;      // Number of bloom filter words
+        ElfTypes::Word bloom_shift;     // Shift for second bloom hash
+
+        template<typename E2>
+        void from(const E2 &o)
+        {
+                nbuckets    = swizzle(o.nbuckets, o.order, order);
+                symoffset   = swizzle(o.symoffset, o.order, order);
+                bloom_size  = swizzle(o.bloom_size, o.order, order);
+                bloom_shift = swizzle(o.bloom_shift, o.order, order);
+        }
+};
+
 // Symbol bindings (ELF32 figure 1-16, ELF64 table 14)
 enum class stb : unsigned char
 {
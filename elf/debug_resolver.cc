@@ -0,0 +1,252 @@
+// Copyright (c) 2026 Huawei Technologies Co. All rights reserved.
+// Use of this source code is governed by an MIT license
+// that can be found in the LICENSE file.
+
+#include "elf++.hh"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <zlib.h>
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+using namespace std;
+
+ELFPP_BEGIN_NAMESPACE
+
+uint32_t
+crc32_update(uint32_t crc, const void *buf, size_t size)
+{
+        const unsigned char *data = (const unsigned char*)buf;
+#if defined(__ARM_FEATURE_CRC32)
+        // The ARMv8 CRC32 instructions implement this polynomial
+        // directly, eight bytes at a time
+        crc = ~crc;
+        for (; size >= 8; data += 8, size -= 8) {
+                uint64_t word;
+                memcpy(&word, data, 8);
+                crc = __crc32d(crc, word);
+        }
+        for (; size; data++, size--)
+                crc = __crc32b(crc, *data);
+        return ~crc;
+#else
+        // zlib's table-driven implementation processes a word at a
+        // time.  x86's SSE4.2 crc32 instruction computes CRC-32C,
+        // which is a different polynomial, so it can't be used.
+        while (size) {
+                uInt n = min(size, (size_t)UINT_MAX);
+                crc = ::crc32(crc, data, n);
+                data += n;
+                size -= n;
+        }
+        return crc;
+#endif
+}
+
+/**
+ * Compute the CRC-32 of the whole file open as fd, or return false
+ * if it cannot be read.
+ */
+static bool
+file_crc32(int fd, uint32_t *crc_out)
+{
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        static constexpr size_t chunk = 1 << 20;
+        unique_ptr<unsigned char[]> buf(new unsigned char[chunk]);
+        uint32_t crc = 0;
+        off_t off = 0;
+        while (true) {
+                ssize_t n = pread(fd, buf.get(), chunk, off);
+                if (n < 0 && errno == EINTR)
+                        continue;
+                if (n < 0)
+                        return false;
+                if (n == 0)
+                        break;
+                crc = crc32_update(crc, buf.get(), n);
+                off += n;
+        }
+        *crc_out = crc;
+        return true;
+}
+
+/**
+ * Open the ELF file at path, or return an invalid elf if it does not
+ * exist or is not an ELF file.  If crc is non-null, the file must
+ * also have that CRC-32.
+ */
+static elf
+try_open(const string &path, const uint32_t *crc)
+{
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+                return elf();
+        elf f;
+        try {
+                uint32_t got;
+                if (!crc || (file_crc32(fd, &got) && got == *crc))
+                        f = elf(create_borrowed_mmap_loader(fd));
+        } catch (format_error &e) {
+        } catch (system_error &e) {
+        } catch (range_error &e) {
+        }
+        close(fd);
+        return f;
+}
+
+static string
+hex_string(const void *data, size_t size)
+{
+        static const char digits[] = "0123456789abcdef";
+        const unsigned char *p = (const unsigned char*)data;
+        string res;
+        for (size_t i = 0; i < size; i++) {
+                res += digits[p[i] >> 4];
+                res += digits[p[i] & 0xF];
+        }
+        return res;
+}
+
+static bool
+same_build_id(const elf &f, const void *id, size_t size)
+{
+        size_t fsize;
+        const void *fid = f.get_build_id(&fsize);
+        return fid && fsize == size && memcmp(fid, id, size) == 0;
+}
+
+/**
+ * Search dirs and the directory of path for the debug file of f, the
+ * ELF file opened from path.
+ */
+static elf
+find_debug_file(const vector<string> &dirs, const elf &f, const string &path)
+{
+        // By build ID, as <dir>/.build-id/xx/yyyy.debug
+        size_t id_size;
+        const void *id = f.get_build_id(&id_size);
+        if (id && id_size >= 2) {
+                string hex = hex_string(id, id_size);
+                for (auto &dir : dirs) {
+                        elf d = try_open(dir + "/.build-id/" +
+                                         hex.substr(0, 2) + "/" +
+                                         hex.substr(2) + ".debug",
+                                         nullptr);
+                        if (d.valid() && same_build_id(d, id, id_size))
+                                return d;
+                }
+        }
+
+        // By .gnu_debuglink, which holds a file name, padding to a
+        // 4-byte boundary, and the CRC-32 of the debug file
+        auto &link = f.get_section(".gnu_debuglink");
+        if (!link.valid() || !link.data())
+                return elf();
+        const char *data = (const char*)link.data();
+        size_t size = link.size();
+        const char *nul = (const char*)memchr(data, 0, size);
+        if (!nul || nul == data)
+                return elf();
+        size_t crc_off = ((nul - data) + 4) & ~(size_t)3;
+        if (crc_off + 4 > size)
+                return elf();
+        string name(data, nul - data);
+        uint32_t crc;
+        memcpy(&crc, data + crc_off, 4);
+        crc = swizzle(crc, f.get_hdr().ei_data == elfdata::lsb ?
+                      byte_order::lsb : byte_order::msb,
+                      byte_order::native);
+
+        // Look next to the file, in its .debug subdirectory, and
+        // under each debug directory at the file's absolute path
+        string dir = ".";
+        size_t slash = path.rfind('/');
+        if (slash != string::npos)
+                dir = slash ? path.substr(0, slash) : "";
+        char real[PATH_MAX];
+        string absdir = realpath(dir.empty() ? "/" : dir.c_str(), real) ?
+                real : dir;
+        if (absdir == "/")
+                absdir = "";
+
+        vector<string> candidates = {dir + "/" + name,
+                                     dir + "/.debug/" + name};
+        for (auto &d : dirs)
+                candidates.push_back(d + absdir + "/" + name);
+        for (auto &c : candidates) {
+                elf d = try_open(c, &crc);
+                if (d.valid())
+                        return d;
+        }
+        return elf();
+}
+
+struct debug_resolver::impl
+{
+        mutex lock;
+        vector<string> dirs;
+        // Resolved debug files, or invalid elfs if there was none,
+        // by build ID
+        unordered_map<string, elf> cache;
+};
+
+debug_resolver::debug_resolver(const vector<string> &debug_dirs)
+        : m(make_shared<impl>())
+{
+        m->dirs = debug_dirs;
+}
+
+void
+debug_resolver::add_debug_dir(const string &dir)
+{
+        lock_guard<mutex> guard(m->lock);
+        m->dirs.insert(m->dirs.begin(), dir);
+        // Earlier misses might be found now
+        for (auto it = m->cache.begin(); it != m->cache.end(); ) {
+                if (it->second.valid())
+                        ++it;
+                else
+                        it = m->cache.erase(it);
+        }
+}
+
+elf
+debug_resolver::resolve(const elf &f, const string &path) const
+{
+        size_t id_size;
+        const void *id = f.get_build_id(&id_size);
+        string key = id ? string((const char*)id, id_size) : string();
+        vector<string> dirs;
+        {
+                lock_guard<mutex> guard(m->lock);
+                if (!key.empty()) {
+                        auto it = m->cache.find(key);
+                        if (it != m->cache.end())
+                                return it->second;
+                }
+                dirs = m->dirs;
+        }
+
+        elf d = find_debug_file(dirs, f, path);
+        if (!key.empty()) {
+                lock_guard<mutex> guard(m->lock);
+                m->cache.emplace(key, d);
+        }
+        return d;
+}
+
+ELFPP_END_NAMESPACE
@@ -5,13 +5,15 @@
 #ifndef _ELFPP_HH_
 #define _ELFPP_HH_
 
-#include "../common/shared_weak.h"
+#include "../common/root_pimpl.h"
 #include "common.hh"
 #include "data.hh"
 
 #include <cstddef>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
+#include <string_view>
 #include <vector>
 
 ELFPP_BEGIN_NAMESPACE
@@ -22,6 +24,11 @@ class section;
 class strtab;
 class symtab;
 class segment;
+class notes;
+class symbol_index;
+class sysv_hash;
+class gnu_hash;
+template<typename T> class lazy_range;
 // XXX Audit for binary compatibility
 
 // XXX Segments, other section types
@@ -44,12 +51,13 @@ public:
  * This class is internally reference counted and efficiently
  * copyable.
  *
- * Raw pointers to ELF data returned by any method of this object or
- * any object derived from this object point directly into loaded
- * section data.  Hence, callers must ensure that the loader passed to
- * this file remains live as long as any such pointer is in use.
- * Keeping any object that can return such a pointer live is
- * sufficient to keep the loader live.
+ * Sections, segments, symbol tables, and other objects derived from
+ * this file refer back to it through borrowed handles (see
+ * get_borrowed_copy), so they do not keep it alive.  Callers must
+ * keep an elf object for this file live as long as anything derived
+ * from it is in use.  This includes raw pointers to ELF data returned
+ * by any method of this object or a derived object, which point
+ * directly into section data owned by the file's loader.
  */
 class elf
 {
@@ -71,6 +79,13 @@ public:
 
         elf& operator=(const elf &o) = default;
 
+        /**
+         * Open the ELF file at path with an mmap loader.  Returns an
+         * invalid elf if the file cannot be opened, and throws
+         * format_error if it is not an ELF file.
+         */
+        static elf open(const std::string &path);
+
         bool valid() const
         {
                 return m;
@@ -88,9 +103,11 @@ public:
         std::shared_ptr<loader> get_loader() const;
 
         /**
-         * Return the segments in this file.
+         * Return the segments in this file.  Each segment is
+         * constructed the first time it is accessed.  The returned
+         * range is valid as long as this file is.
          */
-        const std::vector<segment> &segments() const;
+        lazy_range<segment> segments() const;
 
         /**
          * Return the segment at the given index. If no such segment
@@ -99,15 +116,21 @@ public:
         const segment &get_segment(unsigned index) const;
 
         /**
-         * Return the sections in this file.
+         * Return the sections in this file.  Each section is
+         * constructed the first time it is accessed, so opening a
+         * file with many sections only pays for the ones that are
+         * used.  The returned range is valid as long as this file is.
          */
-        const std::vector<section> &sections() const;
+        lazy_range<section> sections() const;
 
         /**
          * Return the section with the specified name. If no such
-         * section is found, return an invalid section.
+         * section is found, return an invalid section.  If several
+         * sections have the same name, this returns the first.  The
+         * first call indexes all section names, so later lookups
+         * take constant time.
          */
-        const section &get_section(const std::string &name) const;
+        const section &get_section(std::string_view name) const;
 
         /**
          * Return the section at the given index.  If no such section
@@ -115,17 +138,239 @@ public:
          */
         const section &get_section(unsigned index) const;
 
-        elf get_weak_copy()
-        {
-                elf weak = *this;
-                weak.m.ToWeak();
+        /**
+         * Return the build ID from this file's GNU build ID note and
+         * set *size_out to its length in bytes, or return nullptr if
+         * the file has no build ID.  This points directly into the
+         * loaded note.
+         */
+        const void *get_build_id(size_t *size_out) const;
 
-                return weak;
+        /**
+         * \internal Return a handle to this file that does not own
+         * it.  Objects owned by this file use this to refer back to
+         * it without keeping it alive or paying for reference
+         * counting.  The returned handle is only valid while an
+         * owning handle is live.
+         */
+        elf get_borrowed_copy() const
+        {
+                elf borrowed = *this;
+                borrowed.m.ToBorrowed();
+                return borrowed;
         }
 
 private:
+        friend class section;
+        template<typename T> friend class lazy_range;
+
         struct impl;
-        elfin::SharedWeakPImpl<impl> m;
+        elfin::RootPImpl<impl> m;
+};
+
+/**
+ * A random-access range of the sections or segments of an ELF file.
+ * Elements are references to objects owned by the file, so they
+ * remain valid as long as the file does.  Likewise, iterators refer
+ * to the file rather than the range, so they can outlive the range.
+ * Elements may be accessed from several threads at once.
+ */
+template<typename T>
+class lazy_range
+{
+public:
+        class iterator
+        {
+                elf::impl *m;
+                size_t index;
+
+                iterator(elf::impl *m, size_t index)
+                        : m(m), index(index) { }
+                friend class lazy_range;
+
+        public:
+                typedef std::random_access_iterator_tag iterator_category;
+                typedef T value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const T *pointer;
+                typedef const T &reference;
+
+                iterator() = default;
+
+                const T &operator*() const
+                {
+                        return get(m, index);
+                }
+
+                const T *operator->() const
+                {
+                        return &get(m, index);
+                }
+
+                const T &operator[](difference_type n) const
+                {
+                        return get(m, index + n);
+                }
+
+                iterator &operator++()
+                {
+                        ++index;
+                        return *this;
+                }
+
+                iterator operator++(int)
+                {
+                        iterator cur(*this);
+                        ++index;
+                        return cur;
+                }
+
+                iterator &operator--()
+                {
+                        --index;
+                        return *this;
+                }
+
+                iterator operator--(int)
+                {
+                        iterator cur(*this);
+                        --index;
+                        return cur;
+                }
+
+                iterator &operator+=(difference_type n)
+                {
+                        index += n;
+                        return *this;
+                }
+
+                iterator &operator-=(difference_type n)
+                {
+                        index -= n;
+                        return *this;
+                }
+
+                iterator operator+(difference_type n) const
+                {
+                        return iterator(m, index + n);
+                }
+
+                friend iterator operator+(difference_type n, const iterator &it)
+                {
+                        return it + n;
+                }
+
+                iterator operator-(difference_type n) const
+                {
+                        return iterator(m, index - n);
+                }
+
+                difference_type operator-(const iterator &o) const
+                {
+                        return (difference_type)(index - o.index);
+                }
+
+                bool operator==(const iterator &o) const
+                {
+                        return index == o.index;
+                }
+
+                bool operator!=(const iterator &o) const
+                {
+                        return index != o.index;
+                }
+
+                bool operator<(const iterator &o) const
+                {
+                        return index < o.index;
+                }
+
+                bool operator>(const iterator &o) const
+                {
+                        return index > o.index;
+                }
+
+                bool operator<=(const iterator &o) const
+                {
+                        return index <= o.index;
+                }
+
+                bool operator>=(const iterator &o) const
+                {
+                        return index >= o.index;
+                }
+        };
+
+        size_t size() const
+        {
+                return n;
+        }
+
+        bool empty() const
+        {
+                return n == 0;
+        }
+
+        /**
+         * Return the element at index, constructing it if this is
+         * the first access.  index must be less than size().
+         */
+        const T &operator[](size_t index) const
+        {
+                return get(m, index);
+        }
+
+        /**
+         * Return the element at index.  Throws std::out_of_range if
+         * index is not less than size().
+         */
+        const T &at(size_t index) const
+        {
+                if (index >= n)
+                        throw std::out_of_range("index out of range");
+                return get(m, index);
+        }
+
+        iterator begin() const
+        {
+                return iterator(m, 0);
+        }
+
+        iterator end() const
+        {
+                return iterator(m, n);
+        }
+
+private:
+        friend class elf;
+
+        lazy_range(elf::impl *m, size_t n) : m(m), n(n) { }
+
+        static const T &get(elf::impl *m, size_t index);
+
+        elf::impl *m;
+        size_t n;
+};
+
+template<>
+const section &lazy_range<section>::get(elf::impl *m, size_t index);
+template<>
+const segment &lazy_range<segment>::get(elf::impl *m, size_t index);
+
+/**
+ * How a range of loaded data is expected to be accessed.  Loaders use
+ * this to tune readahead and caching.
+ */
+enum class access_pattern
+{
+        // No particular pattern
+        normal,
+        // Read front to back, likely once, as in a full DIE walk
+        sequential,
+        // Scattered small reads, as in address lookups
+        random,
+        // Needed soon; start reading it in now
+        willneed,
 };
 
 /**
@@ -139,19 +384,87 @@ public:
         /**
          * Load the requested file section into memory and return a
          * pointer to the beginning of it.  This memory must remain
-         * valid and unchanged until the loader is destroyed.  If the
-         * loader cannot satisfy the full request for any reason
-         * (including a premature EOF), it must throw an exception.
+         * valid and unchanged until the loader is destroyed or the
+         * data is released.  If the loader cannot satisfy the full
+         * request for any reason (including a premature EOF), it
+         * must throw an exception.
          */
         virtual const void *load(off_t offset, size_t size) = 0;
+
+        /**
+         * Release data returned by an earlier load(offset, size)
+         * call, which the caller must not use afterwards.  Each load
+         * call is released at most once.  Loaders that don't own
+         * the memory they return, like the mmap loader, can ignore
+         * this.
+         */
+        virtual void release(const void *data, size_t size) { }
+
+        /**
+         * Hint that load(offset, size) will be called soon.  Loaders
+         * that can read in the background should start reading the
+         * range now so the later load doesn't wait for I/O.  The
+         * default does nothing.
+         */
+        virtual void prefetch(off_t offset, size_t size) { }
+
+        /**
+         * Hint how the given file range will be accessed from now on.
+         * The range does not have to be loaded yet.  The default does
+         * nothing.
+         */
+        virtual void advise(off_t offset, size_t size,
+                            access_pattern pattern) { }
 };
 
 /**
  * An mmap-based loader that maps requested sections on demand.  This
  * will close fd when done, so the caller should dup the file
- * descriptor if it intends to continue using it.
+ * descriptor if it intends to continue using it.  If populate is
+ * true, the whole file is read in when it is mapped, so later
+ * accesses do not fault; this suits batch jobs that will touch most
+ * of the file anyway.
  */
-std::shared_ptr<loader> create_mmap_loader(int fd);
+std::shared_ptr<loader> create_mmap_loader(int fd, bool populate = false);
+
+/**
+ * Like create_mmap_loader, but leaves fd open and owned by the
+ * caller.  The mapping does not depend on fd, so the caller may
+ * close it at any time.
+ */
+std::shared_ptr<loader> create_borrowed_mmap_loader(int fd,
+                                                    bool populate = false);
+
+/**
+ * A loader for an ELF image that is already in memory, such as one
+ * from a cache, a shared memory segment, or a JIT.  Loads return
+ * pointers into the image, so nothing is copied or read.  The image
+ * must stay valid and unchanged while the loader is live; the loader
+ * holds keepalive, if given, to ensure this.
+ */
+std::shared_ptr<loader>
+create_memory_loader(const void *data, size_t size,
+                     std::shared_ptr<const void> keepalive = nullptr);
+
+/**
+ * A loader that reads each requested range into its own buffer with
+ * pread, and frees the buffer once every load of the range is
+ * released.  Memory use follows the data in use rather than the file
+ * size, which suits huge files and tight address-space limits.  This
+ * will close fd when done.
+ */
+std::shared_ptr<loader> create_pread_loader(int fd);
+
+/**
+ * A pread loader that serves prefetch requests from a pool of
+ * threads worker threads, so reads of several sections can proceed
+ * concurrently with each other and with the caller.  A load of a
+ * range that is still being prefetched waits for that read instead
+ * of issuing another one.  Prefetched ranges that are never loaded
+ * stay in memory until the loader is destroyed.  This will close fd
+ * when done.
+ */
+std::shared_ptr<loader> create_async_loader(int fd, unsigned threads = 4);
 
 /**
  * An exception indicating that a section is not of the requested type.
@@ -185,6 +498,9 @@ public:
        segment(const segment &o) = default;
        segment(segment &&o) = default;
 
+       segment& operator=(const segment &o) = default;
+       segment& operator=(segment &&o) = default;
+
        /**
         * Return true if this segment is valid and corresponds to a
         * segment in the ELF file.
@@ -196,7 +512,8 @@ public:
 
        /**
         * Return the ELF section header in canonical form (ELF64 in
-        * native byte order).
+        * native byte order).  If the file is already in this form,
+        * this points directly into the loaded program header table.
         */
        const Phdr<> &get_hdr() const;
 
@@ -206,6 +523,13 @@ public:
         */
        const void *data() const;
 
+       /**
+        * Release this segment's data back to the loader.  Pointers
+        * returned by data() and objects made from this segment
+        * become invalid.  A later data() call loads the data again.
+        */
+       void release() const;
+
        /**
         * Return the on disk size of this segment in bytes.
         */
@@ -217,6 +541,13 @@ public:
         */
        size_t mem_size() const;
 
+       /**
+        * Return this segment as a list of notes.  Throws
+        * section_type_mismatch if this segment is not a note
+        * segment.
+        */
+       notes as_notes() const;
+
 private:
        struct impl;
        std::shared_ptr<impl> m;
@@ -242,6 +573,9 @@ public:
         section(const section &o) = default;
         section(section &&o) = default;
 
+        section& operator=(const section &o) = default;
+        section& operator=(section &&o) = default;
+
         /**
          * Return true if this section is valid and corresponds to a
          * section in the ELF file.
@@ -253,7 +587,8 @@ public:
 
         /**
          * Return the ELF section header in canonical form (ELF64 in
-         * native byte order).
+         * native byte order).  If the file is already in this form,
+         * this points directly into the loaded section header table.
          */
         const Shdr<> &get_hdr() const;
 
@@ -266,17 +601,54 @@ public:
          * data, so loader liveness requirements don't apply.
          */
         std::string get_name() const;
+        /**
+         * Return this section's name as a view of the section name
+         * string table.  This does not allocate.
+         */
+        std::string_view get_name_view() const;
 
         /**
          * Return this section's data.  If this is a NOBITS section,
          * return nullptr.
          */
         const void *data() const;
+        /**
+         * Release this section's data back to the loader.  Pointers
+         * returned by data() and uncompressed_data() and objects
+         * made from this section, such as strtabs and symtabs,
+         * become invalid.  A later data() call loads the data again.
+         * The section name string table is never released, since
+         * the file keeps using it.
+         */
+        void release() const;
         /**
          * Return the size of this section in bytes.
          */
         size_t size() const;
 
+        /**
+         * Return true if this section's data is compressed, either
+         * with shf::compressed or as a legacy GNU .zdebug section.
+         * This may be called from several threads at once.
+         */
+        bool is_compressed() const;
+        /**
+         * Return this section's data, decompressing it if it is
+         * compressed.  The decompressed data is cached with the
+         * section, so each section is decompressed at most once per
+         * elf object until release() drops it.  This may be called
+         * from several threads at once once data() has been called.
+         * Throws format_error if the compressed data is malformed or
+         * uses an unsupported algorithm.
+         */
+        const void *uncompressed_data() const;
+        /**
+         * Return the size of uncompressed_data() in bytes.  Like
+         * uncompressed_data(), this decompresses the section if
+         * necessary.
+         */
+        size_t uncompressed_size() const;
+
         /**
          * Return this section as a strtab.  Throws
          * section_type_mismatch if this section is not a string
@@ -291,6 +663,27 @@ public:
          */
         symtab as_symtab() const;
 
+        /**
+         * Return this section as a list of notes.  Throws
+         * section_type_mismatch if this section is not a note
+         * section.
+         */
+        notes as_notes() const;
+
+        /**
+         * Return this section as a SysV symbol hash table.  Throws
+         * section_type_mismatch if this section is not a .hash
+         * section.
+         */
+        sysv_hash as_hash() const;
+
+        /**
+         * Return this section as a GNU symbol hash table.  Throws
+         * section_type_mismatch if this section is not a .gnu.hash
+         * section.
+         */
+        gnu_hash as_gnu_hash() const;
+
 private:
         struct impl;
         std::shared_ptr<impl> m;
@@ -330,6 +723,11 @@ public:
          * Return the string at the given offset in this string table.
          */
         std::string get(Elf64::Off offset) const;
+        /**
+         * Return the string at the given offset in this string table
+         * as a view of the loaded section.  This does not allocate.
+         */
+        std::string_view get_view(Elf64::Off offset) const;
 
 private:
         struct impl;
@@ -342,17 +740,22 @@ private:
 class sym
 {
         const strtab strs;
+        // Points into the file if the symbol is already canonical;
+        // otherwise, nullptr and data holds a canonical copy
+        const Sym<> *native;
         Sym<> data;
 
 public:
-        sym(elf f, const void *data, strtab strs);
+        sym(const elf &f, const void *data, strtab strs);
+        sym(const void *data, strtab strs, elfclass ei_class, elfdata ei_data);
 
         /**
-         * Return this symbol's raw data.
+         * Return this symbol's raw data.  For ELF64 files in native
+         * byte order, this points directly into the symbol table.
          */
         const Sym<> &get_data() const
         {
-                return data;
+                return native ? *native : data;
         }
 
         /**
@@ -368,6 +771,12 @@ public:
          * Return this symbol's name as a string.
          */
         std::string get_name() const;
+
+        /**
+         * Return this symbol's name as a view of the string table.
+         * This does not allocate.
+         */
+        std::string_view get_name_view() const;
 };
 
 /**
@@ -394,10 +803,11 @@ public:
 
         class iterator
         {
-                const elf f;
                 const strtab strs;
                 const char *pos;
                 size_t stride;
+                elfclass ei_class;
+                elfdata ei_data;
 
                 iterator(const symtab &tab, const char *pos);
                 friend class symtab;
@@ -405,7 +815,7 @@ public:
         public:
                 sym operator*() const
                 {
-                        return sym(f, pos, strs);
+                        return sym(pos, strs, ei_class, ei_data);
                 }
 
                 iterator& operator++()
@@ -432,12 +842,12 @@ public:
                         return *this;
                 }
 
-                bool operator==(iterator &o) const
+                bool operator==(const iterator &o) const
                 {
                         return pos == o.pos;
                 }
 
-                bool operator!=(iterator &o) const
+                bool operator!=(const iterator &o) const
                 {
                         return pos != o.pos;
                 }
@@ -453,6 +863,404 @@ public:
          */
         iterator end() const;
 
+        /**
+         * Return an iterator to the symbol named name, or end() if
+         * there is none.  If this table is linked from a .gnu.hash or
+         * .hash section, this uses that section, which covers the
+         * symbols a dynamic linker can look up.  Otherwise, the first
+         * call builds a hash table of the names of all symbols.
+         * This may be called from several threads at once.
+         */
+        iterator lookup(const char *name) const;
+
+private:
+        friend class symbol_index;
+        friend class sysv_hash;
+        friend class gnu_hash;
+
+        struct impl;
+        std::shared_ptr<impl> m;
+};
+
+/**
+ * A SysV symbol hash table (.hash).
+ *
+ * This class is internally reference counted and efficiently
+ * copyable.
+ */
+class sysv_hash
+{
+public:
+        /**
+         * Construct a hash table that is initially not valid.
+         * Calling methods other than operator= and valid on this
+         * results in undefined behavior.
+         */
+        sysv_hash() = default;
+
+        /**
+         * Construct a hash table from section data.  entsize is the
+         * size of each bucket and chain entry.  Throws format_error
+         * if the table is malformed.
+         */
+        sysv_hash(elf f, const void *data, size_t size, size_t entsize);
+
+        bool valid() const
+        {
+                return !!m;
+        }
+
+        /**
+         * Return the SysV ELF hash of name.
+         */
+        static std::uint32_t hash(const char *name);
+
+        /**
+         * Return the index in syms of the symbol named name, or 0 if
+         * there is none.  syms must be the symbol table this hash
+         * table is linked to.
+         */
+        size_t lookup(const symtab &syms, const char *name) const;
+
+private:
+        struct impl;
+        std::shared_ptr<impl> m;
+};
+
+/**
+ * A GNU symbol hash table (.gnu.hash).
+ *
+ * This class is internally reference counted and efficiently
+ * copyable.
+ */
+class gnu_hash
+{
+public:
+        /**
+         * Construct a hash table that is initially not valid.
+         * Calling methods other than operator= and valid on this
+         * results in undefined behavior.
+         */
+        gnu_hash() = default;
+
+        /**
+         * Construct a hash table from section data.  Throws
+         * format_error if the table is malformed.
+         */
+        gnu_hash(elf f, const void *data, size_t size);
+
+        bool valid() const
+        {
+                return !!m;
+        }
+
+        /**
+         * Return the GNU hash of name.
+         */
+        static std::uint32_t hash(const char *name);
+
+        /**
+         * Return the index in syms of the symbol named name, or 0 if
+         * there is none.  syms must be the symbol table this hash
+         * table is linked to.  Most misses are rejected by the bloom
+         * filter without reading the symbol or string tables.
+         */
+        size_t lookup(const symtab &syms, const char *name) const;
+
+private:
+        struct impl;
+        std::shared_ptr<impl> m;
+};
+
+/**
+ * An index of the function and object symbols of one or more symbol
+ * tables, sorted by address.
+ *
+ * This class is internally reference counted and efficiently
+ * copyable.  Copies share the same index.
+ */
+class symbol_index
+{
+public:
+        /**
+         * A symbol in the index.
+         */
+        struct entry
+        {
+                Elf64::Addr   value;  // Symbol value (address)
+                Elf64::Xword  size;   // Size of object
+                Elf64::Word   name;   // Symbol name (strtab offset)
+                unsigned char info;   // Type and binding attributes
+                unsigned char table;  // Index of the source symbol table
+
+                stb binding() const
+                {
+                        return (stb)(info >> 4);
+                }
+
+                stt type() const
+                {
+                        return (stt)(info & 0xF);
+                }
+        };
+
+        /**
+         * Construct a symbol index that is initially not valid.
+         * Calling methods other than operator= and valid on this
+         * results in undefined behavior.
+         */
+        symbol_index() = default;
+
+        /**
+         * Construct an index of the .symtab and .dynsym sections of
+         * f.  Either or both may be missing.  If f has no .symtab,
+         * this also indexes the symbol table of f's MiniDebugInfo,
+         * if any (see open_gnu_debugdata).  The index keeps f and the
+         * MiniDebugInfo image alive.
+         */
+        explicit symbol_index(const elf &f);
+
+        bool valid() const
+        {
+                return !!m;
+        }
+
+        /**
+         * Add the defined STT_FUNC and STT_OBJECT symbols of tab to
+         * this index.  Symbols with the same value, size, and type
+         * are aliases; only the one with the strongest binding is
+         * kept.  The file of tab must remain live as long as this
+         * index.
+         */
+        void add(const symtab &tab);
+
+        /**
+         * Return the symbol containing addr, or nullptr if there is
+         * none.  This considers only the symbol with the greatest
+         * value not exceeding addr.  Symbols with a size of zero
+         * contain only their own address.
+         */
+        const entry *find(Elf64::Addr addr) const;
+
+        /**
+         * Look up count addresses at once.  addrs must be sorted in
+         * ascending order.  Sets out[i] to find(addrs[i]).  This
+         * makes a single pass over the index.
+         */
+        void find(const Elf64::Addr *addrs, size_t count,
+                  const entry **out) const;
+
+        /**
+         * Return the name of e, which must be an entry of this
+         * index.
+         */
+        const char *get_name(const entry &e, size_t *len_out) const;
+
+        /**
+         * Return the name of e as a string.
+         */
+        std::string get_name(const entry &e) const;
+
+        /**
+         * Return the name of e as a view of its string table.
+         */
+        std::string_view get_name_view(const entry &e) const;
+
+        /**
+         * Return the entries of this index in address order.
+         */
+        const entry *begin() const;
+        const entry *end() const;
+        size_t size() const;
+
+private:
+        struct impl;
+        std::shared_ptr<impl> m;
+};
+
+/**
+ * Return the MiniDebugInfo ELF image embedded in the xz-compressed
+ * .gnu_debugdata section of f, or an invalid elf if f has none.
+ * Stripped distribution binaries keep their full symbol table there.
+ * The returned file is independent of f.  Decompressed images are
+ * cached by f's build ID, so opening the same binary again does not
+ * decompress it again.  Throws format_error if the section cannot be
+ * decompressed.
+ */
+elf open_gnu_debugdata(const elf &f);
+
+/**
+ * Finds the separate debug files of stripped ELF files, the way
+ * debuggers do.  A file's debug file is looked up first by build ID,
+ * as .build-id/xx/yyyy.debug under each debug directory, and then by
+ * the name in its .gnu_debuglink section: next to the file, in the
+ * .debug subdirectory next to it, and under each debug directory at
+ * the file's absolute directory.  Files found by debuglink must match
+ * its CRC-32.
+ *
+ * Results are cached by build ID, so resolving the same binary again
+ * returns the same elf without searching or checksumming again.
+ *
+ * This class is internally reference counted and efficiently
+ * copyable.  Copies share the same cache.  It may be used from
+ * several threads at once.
+ */
+class debug_resolver
+{
+public:
+        /**
+         * Construct a resolver that searches the given debug
+         * directories, in order.
+         */
+        explicit debug_resolver(const std::vector<std::string> &debug_dirs =
+                                {"/usr/lib/debug"});
+
+        /**
+         * Search dir, such as a local symbol store, before the
+         * directories already configured.
+         */
+        void add_debug_dir(const std::string &dir);
+
+        /**
+         * Return the debug file of f, which was opened from path, or
+         * an invalid elf if there is none.  path is only used for
+         * debuglink lookups.
+         */
+        elf resolve(const elf &f, const std::string &path) const;
+
+private:
+        struct impl;
+        std::shared_ptr<impl> m;
+};
+
+/**
+ * \internal Continue the CRC-32 crc (the zlib/IEEE 802.3 CRC used by
+ * .gnu_debuglink) over size bytes at data.  Start from 0.  Exposed
+ * so the tests can check it against zlib on every target.
+ */
+uint32_t crc32_update(uint32_t crc, const void *data, size_t size);
+
+/**
+ * A note from a note section or segment.
+ */
+class note
+{
+        Nhdr<> hdr;
+        const char *name;
+        const void *desc;
+
+public:
+        note(elfdata ei_data, const void *data, unsigned align);
+
+        /**
+         * Return this note's header in canonical form (native byte
+         * order).
+         */
+        const Nhdr<> &get_hdr() const
+        {
+                return hdr;
+        }
+
+        /**
+         * Return the name of the originator of this note, such as
+         * "CORE" or "GNU".  This points directly into the loaded
+         * data.  If the name is missing or not NUL-terminated, this
+         * returns "".
+         */
+        const char *get_name() const
+        {
+                return name;
+        }
+
+        /**
+         * Return this note's descriptor.  This points directly into
+         * the loaded data and is get_desc_size() bytes long.
+         */
+        const void *get_desc() const
+        {
+                return desc;
+        }
+
+        size_t get_desc_size() const
+        {
+                return hdr.descsz;
+        }
+};
+
+/**
+ * The notes in a note section or segment.
+ *
+ * This class is internally reference counted and efficiently
+ * copyable.
+ */
+class notes
+{
+public:
+        /**
+         * Construct a notes object that is initially not valid.
+         * Calling methods other than operator= and valid on this
+         * results in undefined behavior.
+         */
+        notes() = default;
+        notes(elf f, const void *data, size_t size, size_t align);
+
+        bool valid() const
+        {
+                return !!m;
+        }
+
+        class iterator
+        {
+                const char *pos, *end;
+                unsigned align;
+                elfdata ei_data;
+
+                iterator(const notes &n, const char *pos);
+                friend class notes;
+
+                /**
+                 * Return pos if the note at pos fits before end,
+                 * otherwise end.
+                 */
+                const char *check(const char *pos) const;
+
+        public:
+                note operator*() const
+                {
+                        return note(ei_data, pos, align);
+                }
+
+                iterator& operator++();
+
+                iterator operator++(int)
+                {
+                        iterator cur(*this);
+                        ++*this;
+                        return cur;
+                }
+
+                bool operator==(const iterator &o) const
+                {
+                        return pos == o.pos;
+                }
+
+                bool operator!=(const iterator &o) const
+                {
+                        return pos != o.pos;
+                }
+        };
+
+        /**
+         * Return an iterator to the first note.  Iteration stops
+         * early at a note that does not fit in the section.
+         */
+        iterator begin() const;
+
+        /**
+         * Return an iterator just past the last note.
+         */
+        iterator end() const;
+
 private:
         struct impl;
         std::shared_ptr<impl> m;
@@ -5,7 +5,19 @@
 #include "elf++.hh"
 #include "sig_handler.hh"
 
+#include <algorithm>
+#include <climits>
 #include <cstring>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef ELFPP_HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 using namespace std;
 
@@ -38,6 +50,56 @@ void canon_hdr(Hdr<Elf64, byte_order::native> *out, const void *data,
         }
 }
 
+/**
+ * Return whether headers in a file of the given class and byte order
+ * are already in canonical form.
+ */
+static bool
+is_canonical(elfclass ei_class, elfdata ei_data)
+{
+        return ei_class == elfclass::_64 &&
+                (ei_data == elfdata::lsb) ==
+                (resolve_order(byte_order::native) == byte_order::lsb);
+}
+
+/**
+ * Whether the canonical form of Hdr overlays the same header in a
+ * canonical file.  The canonical Shdr narrows the sh_link word to a
+ * section number, which only overlays the low half of the word on
+ * little-endian hosts.
+ */
+template<template<typename E, byte_order Order> class Hdr>
+struct overlays_file
+{
+        static const bool value = true;
+};
+
+template<>
+struct overlays_file<Shdr>
+{
+        static const bool value =
+                __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+};
+
+/**
+ * Return a canonical view of the header at data.  If the file is
+ * ELF64 in native byte order and data is suitably aligned, this
+ * points directly at data.  Otherwise, this canonicalizes the header
+ * into *buf and returns buf.
+ */
+template<template<typename E, byte_order Order> class Hdr>
+const Hdr<Elf64, byte_order::native> *
+view_hdr(Hdr<Elf64, byte_order::native> *buf, const void *data,
+         elfclass ei_class, elfdata ei_data)
+{
+        typedef Hdr<Elf64, byte_order::native> canon;
+        if (overlays_file<Hdr>::value && is_canonical(ei_class, ei_data) &&
+            (uintptr_t)data % alignof(canon) == 0)
+                return (const canon*)data;
+        canon_hdr(buf, data, ei_class, ei_data);
+        return buf;
+}
+
 //////////////////////////////////////////////////////////////////
 // class elf
 //
@@ -49,11 +111,68 @@ struct elf::impl
 
         const shared_ptr<loader> l;
         Ehdr<> hdr;
+        // A borrowed handle to the owning elf, for sections and
+        // segments
+        elf borrowed;
+
+        // Raw section and program header tables
+        const char *sec_hdrs, *seg_hdrs;
+        // The real section count and name string table index, which
+        // may be too large for the ELF header
+        size_t shnum;
+        unsigned shstrndx;
+
+        // Sections and segments, each constructed on first access.
+        // The once flags let several threads access them at once,
+        // as they could when these were built up front.
         vector<section> sections;
         vector<segment> segments;
+        unique_ptr<once_flag[]> sections_once, segments_once;
 
         section invalid_section;
         segment invalid_segment;
+
+        // The section name string table, loaded on first use
+        strtab section_names;
+        once_flag section_names_once;
+        // Index of the first section with each name, built on first
+        // use
+        unordered_map<string_view, unsigned> section_index;
+        once_flag section_index_once;
+
+        const section &get_section(size_t index)
+        {
+                call_once(sections_once[index], [&] {
+                        sections[index] = section(
+                                borrowed, sec_hdrs + index * hdr.shentsize);
+                });
+                return sections[index];
+        }
+
+        const segment &get_segment(size_t index)
+        {
+                call_once(segments_once[index], [&] {
+                        segments[index] = segment(
+                                borrowed, seg_hdrs + index * hdr.phentsize);
+                });
+                return segments[index];
+        }
+
+        /**
+         * Return the section name string table.  Throws
+         * format_error if there is none.
+         */
+        const strtab &get_section_names()
+        {
+                if (shstrndx >= shnum)
+                        throw format_error("no section name string table");
+                call_once(section_names_once, [&] {
+                        section_names = get_section(shstrndx).as_strtab();
+                });
+                return section_names;
+        }
+
+        void build_section_index();
 };
 
 elf::elf(const std::shared_ptr<loader> &l)
@@ -87,31 +206,71 @@ elf::elf(const std::shared_ptr<loader> &l)
         const void *hdr = l->load(0, hdr_size);
         auto shared_impl = m.GetShared();
         canon_hdr(&shared_impl->hdr, hdr, core_hdr->ei_class, core_hdr->ei_data);
+        auto &ehdr = shared_impl->hdr;
 
         // More checks
-        if (shared_impl->hdr.version != 1)
+        if (ehdr.version != 1)
                 throw format_error("bad section ELF version");
-        if (shared_impl->hdr.shnum && shared_impl->hdr.shstrndx >= shared_impl->hdr.shnum)
-                throw format_error("bad section name string table index");
 
-        auto weakCopy = get_weak_copy();
-        // Load segments
-        const void *seg_data = l->load(shared_impl->hdr.phoff,
-                                       shared_impl->hdr.phentsize * shared_impl->hdr.phnum);
-        for (unsigned i = 0; i < shared_impl->hdr.phnum; i++) {
-                const void *seg = ((const char*)seg_data) + i * shared_impl->hdr.phentsize;
-                shared_impl->segments.push_back(segment(weakCopy, seg));
+        // Files with SHN_LORESERVE or more sections keep the real
+        // section count and name table index in section 0.
+        shared_impl->shnum = ehdr.shnum;
+        shared_impl->shstrndx = ehdr.shstrndx;
+        if (ehdr.shoff && (ehdr.shnum == 0 || ehdr.shstrndx == 0xffff)) {
+                const char *raw = (const char*)l->load(ehdr.shoff,
+                                                       ehdr.shentsize);
+                Shdr<> sh0;
+                canon_hdr(&sh0, raw, ehdr.ei_class, ehdr.ei_data);
+                if (ehdr.shnum == 0)
+                        shared_impl->shnum = sh0.size;
+                // SHN_XINDEX.  The canonical sh_link is only a
+                // half-word, so read the full word from the file.
+                if (ehdr.shstrndx == 0xffff) {
+                        typedef Shdr<Elf32, byte_order::lsb> shdr32;
+                        typedef Shdr<Elf64, byte_order::lsb> shdr64;
+                        size_t off = ehdr.ei_class == elfclass::_32 ?
+                                offsetof(shdr32, link) :
+                                offsetof(shdr64, link);
+                        Elf64::Word link;
+                        memcpy(&link, raw + off, sizeof link);
+                        shared_impl->shstrndx = swizzle(
+                                link, ehdr.ei_data == elfdata::lsb ?
+                                byte_order::lsb : byte_order::msb,
+                                byte_order::native);
+                }
         }
+        if (shared_impl->shnum &&
+            shared_impl->shstrndx >= shared_impl->shnum)
+                throw format_error("bad section name string table index");
 
-        // Load sections
-        const void *sec_data = l->load(shared_impl->hdr.shoff,
-                                       shared_impl->hdr.shentsize * shared_impl->hdr.shnum);
-        for (unsigned i = 0; i < shared_impl->hdr.shnum; i++) {
-                const void *sec = ((const char*)sec_data) + i * shared_impl->hdr.shentsize;
-                // XXX Circular reference.  Maybe this should be
-                // constructed on the fly?  Canonicalizing the header
-                // isn't super-cheap.
-                shared_impl->sections.push_back(section(weakCopy, sec));
+        // Load the header tables, but defer constructing segments and
+        // sections until they are used
+        shared_impl->borrowed = get_borrowed_copy();
+        shared_impl->seg_hdrs = (const char*)l->load(
+                ehdr.phoff, ehdr.phentsize * ehdr.phnum);
+        shared_impl->segments.resize(ehdr.phnum);
+        shared_impl->segments_once.reset(new once_flag[ehdr.phnum]);
+        shared_impl->sec_hdrs = (const char*)l->load(
+                ehdr.shoff, ehdr.shentsize * shared_impl->shnum);
+        shared_impl->sections.resize(shared_impl->shnum);
+        shared_impl->sections_once.reset(new once_flag[shared_impl->shnum]);
+}
+
+elf
+elf::open(const std::string &path)
+{
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+                return elf();
+        // The mapping does not need fd, so close it even if
+        // constructing the file fails
+        try {
+                elf f(create_borrowed_mmap_loader(fd));
+                close(fd);
+                return f;
+        } catch (...) {
+                close(fd);
+                throw;
         }
 }
 
@@ -127,41 +286,121 @@ elf::get_loader() const
         return m.Get().l;
 }
 
-const std::vector<section> &
+lazy_range<section>
 elf::sections() const
 {
-        return m.Get().sections;
+        auto &impl = m.Get();
+        return lazy_range<section>(&impl, impl.sections.size());
 }
 
-const std::vector<segment> &
+lazy_range<segment>
 elf::segments() const
 {
-        return m.Get().segments;
+        auto &impl = m.Get();
+        return lazy_range<segment>(&impl, impl.segments.size());
+}
+
+template<>
+const section &
+lazy_range<section>::get(elf::impl *m, size_t index)
+{
+        return m->get_section(index);
+}
+
+template<>
+const segment &
+lazy_range<segment>::get(elf::impl *m, size_t index)
+{
+        return m->get_segment(index);
+}
+
+void
+elf::impl::build_section_index()
+{
+        // Read names straight from the section headers so this
+        // doesn't construct every section
+        const strtab &names = get_section_names();
+        section_index.reserve(shnum);
+        Shdr<> buf;
+        for (unsigned i = 0; i < shnum; i++) {
+                const Shdr<> *sh = view_hdr(&buf, sec_hdrs + i * hdr.shentsize,
+                                            hdr.ei_class, hdr.ei_data);
+                size_t len;
+                const char *name = names.get(sh->name, &len);
+                section_index.emplace(string_view(name, len), i);
+        }
 }
 
 const section &
-elf::get_section(const std::string &name) const
+elf::get_section(std::string_view name) const
 {
-        for (auto &sec : sections())
-                if (name == sec.get_name(nullptr))
-                        return sec;
-        return m.Get().invalid_section;
+        auto &impl = m.Get();
+        // Files without section headers, such as core files, have
+        // no names to index
+        if (impl.shstrndx >= impl.shnum)
+                return impl.invalid_section;
+        call_once(impl.section_index_once,
+                  [&] { impl.build_section_index(); });
+        auto it = impl.section_index.find(name);
+        if (it == impl.section_index.end())
+                return impl.invalid_section;
+        return impl.get_section(it->second);
 }
 
 const section &
 elf::get_section(unsigned index) const
 {
-        if (index >= sections().size())
-                return m.Get().invalid_section;
-        return sections().at(index);
+        auto &impl = m.Get();
+        if (index >= impl.sections.size())
+                return impl.invalid_section;
+        return impl.get_section(index);
 }
 
 const segment&
 elf::get_segment(unsigned index) const
 {
-        if (index >= segments().size())
-                return m.Get().invalid_segment;
-        return segments().at(index);
+        auto &impl = m.Get();
+        if (index >= impl.segments.size())
+                return impl.invalid_segment;
+        return impl.get_segment(index);
+}
+
+const void *
+elf::get_build_id(size_t *size_out) const
+{
+        auto find = [&](const notes &ns) -> const void * {
+                for (auto n : ns) {
+                        if (n.get_hdr().type ==
+                            (ElfTypes::Word)nt_gnu::build_id &&
+                            strcmp(n.get_name(), "GNU") == 0) {
+                                *size_out = n.get_desc_size();
+                                return n.get_desc();
+                        }
+                }
+                return nullptr;
+        };
+
+        // Try the usual section first, then any note section, then
+        // note segments for files without section headers
+        const void *id = nullptr;
+        auto &named = get_section(".note.gnu.build-id");
+        if (named.valid() && named.get_hdr().type == sht::note)
+                id = find(named.as_notes());
+        for (auto &sec : sections()) {
+                if (id)
+                        break;
+                if (sec.get_hdr().type == sht::note)
+                        id = find(sec.as_notes());
+        }
+        if (!id && sections().size() == 0) {
+                for (auto &seg : segments()) {
+                        if (id)
+                                break;
+                        if (seg.get_hdr().type == pt::note)
+                                id = find(seg.as_notes());
+                }
+        }
+        return id;
 }
 
 //////////////////////////////////////////////////////////////////
@@ -173,36 +412,54 @@ struct segment::impl {
                 : f(f), data(nullptr) { }
 
         const elf f;
-        Phdr<> hdr;
+        // Points either into the file or at hdr_buf
+        const Phdr<> *hdr;
+        Phdr<> hdr_buf;
         const void *data;
 };
 
 segment::segment(const elf &f, const void *hdr)
     : m(make_shared<impl>(f)) {
-        canon_hdr(&m->hdr, hdr, f.get_hdr().ei_class, f.get_hdr().ei_data);
+        m->hdr = view_hdr(&m->hdr_buf, hdr, f.get_hdr().ei_class,
+                          f.get_hdr().ei_data);
 }
 
 const Phdr<> &
 segment::get_hdr() const {
-        return m->hdr;
+        return *m->hdr;
 }
 
 const void *
 segment::data() const {
         if (!m->data)
-                m->data = m->f.get_loader()->load(m->hdr.offset,
-                                                  m->hdr.filesz);
+                m->data = m->f.get_loader()->load(m->hdr->offset,
+                                                  m->hdr->filesz);
         return m->data;
 }
 
+void
+segment::release() const {
+        if (!m->data)
+                return;
+        m->f.get_loader()->release(m->data, m->hdr->filesz);
+        m->data = nullptr;
+}
+
 size_t
 segment::file_size() const {
-        return m->hdr.filesz;
+        return m->hdr->filesz;
 }
 
 size_t
 segment::mem_size() const {
-        return m->hdr.memsz;
+        return m->hdr->memsz;
+}
+
+notes
+segment::as_notes() const {
+        if (m->hdr->type != pt::note)
+                throw section_type_mismatch("cannot use segment as notes");
+        return notes(m->f, data(), file_size(), m->hdr->align);
 }
 
 //////////////////////////////////////////////////////////////////
@@ -227,31 +484,143 @@ struct section::impl
                 : f(f), name(nullptr), data(nullptr) { }
 
         const elf f;
-        Shdr<> hdr;
+        // Points either into the file or at hdr_buf
+        const Shdr<> *hdr;
+        Shdr<> hdr_buf;
         const char *name;
         size_t name_len;
         const void *data;
+
+        // Whether the section is compressed, resolved on first use.
+        // This looks up the name of .zdebug sections, so it must
+        // only happen once even when decompressing in the
+        // background.
+        once_flag compressed_once;
+        bool compressed;
+
+        // Decompressed data, if the section is compressed
+        mutex uncompressed_lock;
+        unique_ptr<char[]> uncompressed;
+        size_t uncompressed_size;
+
+        void decompress();
 };
 
+/**
+ * Inflate the zlib stream of in_size bytes at in into out_size bytes
+ * at out.  Returns false if the stream is malformed or does not
+ * decompress to exactly out_size bytes.
+ */
+static bool
+inflate_zlib(const void *in, size_t in_size, char *out, size_t out_size)
+{
+        z_stream zs = {};
+        if (inflateInit(&zs) != Z_OK)
+                return false;
+        // zlib counts in uInts, so feed large sections in pieces
+        const char *next_in = (const char*)in;
+        zs.next_out = (Bytef*)out;
+        int ret;
+        do {
+                if (zs.avail_in == 0) {
+                        size_t n = min(in_size, (size_t)UINT_MAX);
+                        zs.next_in = (Bytef*)next_in;
+                        zs.avail_in = n;
+                        next_in += n;
+                        in_size -= n;
+                }
+                if (zs.avail_out == 0) {
+                        size_t n = min(out_size, (size_t)UINT_MAX);
+                        zs.avail_out = n;
+                        out_size -= n;
+                }
+                ret = inflate(&zs, Z_NO_FLUSH);
+        } while (ret == Z_OK);
+        bool ok = ret == Z_STREAM_END && zs.avail_out == 0 && out_size == 0;
+        inflateEnd(&zs);
+        return ok;
+}
+
+void
+section::impl::decompress()
+{
+        const char *in = (const char*)data;
+        size_t in_size = hdr->size;
+        elfcompress type;
+        size_t out_size;
+
+        if ((hdr->flags & shf::compressed) == shf::compressed) {
+                auto &ehdr = f.get_hdr();
+                size_t chdr_size = ehdr.ei_class == elfclass::_32 ?
+                        sizeof(Chdr<Elf32>) : sizeof(Chdr<Elf64>);
+                if (in_size < chdr_size)
+                        throw format_error("compressed section too small");
+                Chdr<> chdr{};
+                canon_hdr(&chdr, in, ehdr.ei_class, ehdr.ei_data);
+                type = chdr.type;
+                out_size = chdr.size;
+                in += chdr_size;
+                in_size -= chdr_size;
+        } else {
+                // Legacy GNU .zdebug sections start with "ZLIB" and
+                // the uncompressed size as a big-endian 64-bit number
+                if (in_size < 12 || memcmp(in, "ZLIB", 4) != 0)
+                        throw format_error("bad .zdebug section header");
+                type = elfcompress::zlib;
+                out_size = 0;
+                for (int i = 4; i < 12; i++)
+                        out_size = (out_size << 8) | (unsigned char)in[i];
+                in += 12;
+                in_size -= 12;
+        }
+
+        // Neither algorithm can compress better than these ratios, so
+        // larger sizes are corrupt and shouldn't be allocated
+        size_t max_ratio = type == elfcompress::zstd ? 32768 : 1032;
+        if (out_size / max_ratio > in_size)
+                throw format_error("implausible uncompressed section size");
+
+        unique_ptr<char[]> out(new char[out_size ? out_size : 1]);
+        switch (type) {
+        case elfcompress::zlib:
+                if (!inflate_zlib(in, in_size, out.get(), out_size))
+                        throw format_error("malformed zlib-compressed section");
+                break;
+#ifdef ELFPP_HAVE_ZSTD
+        case elfcompress::zstd: {
+                size_t got = ZSTD_decompress(out.get(), out_size, in, in_size);
+                if (ZSTD_isError(got) || got != out_size)
+                        throw format_error("malformed zstd-compressed section");
+                break;
+        }
+#endif
+        default:
+                throw format_error("unsupported section compression " +
+                                   to_string(type));
+        }
+        uncompressed = move(out);
+        uncompressed_size = out_size;
+}
+
 section::section(const elf &f, const void *hdr)
         : m(make_shared<impl>(f))
 {
-        canon_hdr(&m->hdr, hdr, f.get_hdr().ei_class, f.get_hdr().ei_data);
+        m->hdr = view_hdr(&m->hdr_buf, hdr, f.get_hdr().ei_class,
+                          f.get_hdr().ei_data);
 }
 
 const Shdr<> &
 section::get_hdr() const
 {
-        return m->hdr;
+        return *m->hdr;
 }
 
 const char *
 section::get_name(size_t *len_out) const
 {
-        // XXX Should the section name strtab be cached?
         if (!m->name)
-                m->name = m->f.get_section(m->f.get_hdr().shstrndx)
-                        .as_strtab().get(m->hdr.name, &m->name_len);
+                m->name = m->f.m.Get().get_section_names()
+                        .get(m->hdr->name, &m->name_len);
         if (len_out)
                 *len_out = m->name_len;
         return m->name;
@@ -260,23 +629,76 @@ section::get_name(size_t *len_out) const
 string
 section::get_name() const
 {
-        return get_name(nullptr);
+        return string(get_name_view());
+}
+
+std::string_view
+section::get_name_view() const
+{
+        size_t len;
+        const char *name = get_name(&len);
+        return std::string_view(name, len);
 }
 
 const void *
 section::data() const
 {
-        if (m->hdr.type == sht::nobits)
+        if (m->hdr->type == sht::nobits)
                 return nullptr;
         if (!m->data)
-                m->data = m->f.get_loader()->load(m->hdr.offset, m->hdr.size);
+                m->data = m->f.get_loader()->load(m->hdr->offset, m->hdr->size);
         return m->data;
 }
 
+void
+section::release() const
+{
+        if (!m->data)
+                return;
+        auto &impl = m->f.m.Get();
+        if (impl.shstrndx < impl.shnum &&
+            impl.sections[impl.shstrndx].m == m)
+                return;
+        impl.l->release(m->data, m->hdr->size);
+        m->data = nullptr;
+        lock_guard<mutex> guard(m->uncompressed_lock);
+        m->uncompressed.reset();
+}
+
 size_t
 section::size() const
 {
-        return m->hdr.size;
+        return m->hdr->size;
+}
+
+bool
+section::is_compressed() const
+{
+        call_once(m->compressed_once, [this] {
+                m->compressed =
+                        (m->hdr->flags & shf::compressed) == shf::compressed ||
+                        get_name_view().starts_with(".zdebug");
+        });
+        return m->compressed;
+}
+
+const void *
+section::uncompressed_data() const
+{
+        if (!is_compressed() || !data())
+                return data();
+        lock_guard<mutex> guard(m->uncompressed_lock);
+        if (!m->uncompressed)
+                m->decompress();
+        return m->uncompressed.get();
+}
+
+size_t
+section::uncompressed_size() const
+{
+        if (!is_compressed() || !uncompressed_data())
+                return size();
+        return m->uncompressed_size;
 }
 
 strtab
@@ -284,7 +706,7 @@ section::as_strtab() const
 {
         signal(SIGABRT, sigabrt_handler);
         signal(SIGSEGV, sigsegv_handler);
-        if (m->hdr.type != sht::strtab)
+        if (m->hdr->type != sht::strtab)
                 throw section_type_mismatch("cannot use section as strtab");
         return strtab(m->f, data(), size());
 }
@@ -292,12 +714,39 @@ section::as_strtab() const
 symtab
 section::as_symtab() const
 {
-        if (m->hdr.type != sht::symtab && m->hdr.type != sht::dynsym)
+        if (m->hdr->type != sht::symtab && m->hdr->type != sht::dynsym)
                 throw section_type_mismatch("cannot use section as symtab");
         return symtab(m->f, data(), size(),
                       m->f.get_section(get_hdr().link).as_strtab());
 }
 
+notes
+section::as_notes() const
+{
+        if (m->hdr->type != sht::note)
+                throw section_type_mismatch("cannot use section as notes");
+        return notes(m->f, data(), size(), m->hdr->addralign);
+}
+
+sysv_hash
+section::as_hash() const
+{
+        if (m->hdr->type != sht::hash)
+                throw section_type_mismatch("cannot use section as hash");
+        // Most targets leave sh_entsize 4, but a few 64-bit targets
+        // use 8-byte entries.
+        return sysv_hash(m->f, data(), size(),
+                         m->hdr->entsize ? m->hdr->entsize : 4);
+}
+
+gnu_hash
+section::as_gnu_hash() const
+{
+        if (m->hdr->type != sht::gnu_hash)
+                throw section_type_mismatch("cannot use section as gnu_hash");
+        return gnu_hash(m->f, data(), size());
+}
+
 //////////////////////////////////////////////////////////////////
 // class strtab
 //
@@ -325,10 +774,8 @@ strtab::get(Elf64::Off offset, size_t *len_out) const
                 throw range_error("string offset " + std::to_string(offset) + " exceeds section size");
 
         // Find the null terminator
-        const char *p = start;
-        while (p < m->end && *p)
-                p++;
-        if (p == m->end)
+        const char *p = (const char*)memchr(start, 0, m->end - start);
+        if (!p)
                 throw format_error("unterminated string");
 
         if (len_out)
@@ -342,14 +789,29 @@ strtab::get(Elf64::Off offset) const
         return get(offset, nullptr);
 }
 
+std::string_view
+strtab::get_view(Elf64::Off offset) const
+{
+        size_t len;
+        const char *str = get(offset, &len);
+        return std::string_view(str, len);
+}
+
 //////////////////////////////////////////////////////////////////
 // class sym
 //
 
-sym::sym(elf f, const void *data, strtab strs)
+sym::sym(const elf &f, const void *data, strtab strs)
+        : sym(data, strs, f.get_hdr().ei_class, f.get_hdr().ei_data)
+{
+}
+
+sym::sym(const void *data, strtab strs, elfclass ei_class, elfdata ei_data)
         : strs(strs)
 {
-        canon_hdr(&this->data, data, f.get_hdr().ei_class, f.get_hdr().ei_data);
+        native = view_hdr(&this->data, data, ei_class, ei_data);
+        if (native == &this->data)
+                native = nullptr;
 }
 
 const char *
@@ -361,7 +823,13 @@ sym::get_name(size_t *len_out) const
 std::string
 sym::get_name() const
 {
-        return strs.get(get_data().name);
+        return std::string(get_name_view());
+}
+
+std::string_view
+sym::get_name_view() const
+{
+        return strs.get_view(get_data().name);
 }
 
 //////////////////////////////////////////////////////////////////
@@ -371,11 +839,50 @@ sym::get_name() const
 struct symtab::impl
 {
         impl(const elf &f, const char *data, const char *end, strtab strs)
-                : f(f), data(data), end(end), strs(strs) { }
+                : f(f), data(data), end(end), strs(strs),
+                  stride(f.get_hdr().ei_class == elfclass::_32 ?
+                         sizeof(Sym<Elf32>) : sizeof(Sym<Elf64>)),
+                  count((end - data) / stride) { }
 
         const elf f;
         const char *data, *end;
         const strtab strs;
+        const size_t stride, count;
+
+        // Hash tables linked to this symbol table, found on the first
+        // lookup.  Like the sections of a file, these are built
+        // under once flags so concurrent lookups are safe.
+        once_flag hashes_once;
+        gnu_hash gnu;
+        sysv_hash sysv;
+        // Names of all symbols, built on the first lookup if there is
+        // no hash table
+        once_flag names_once;
+        unordered_map<string_view, size_t> names;
+
+        /**
+         * Return the symbol at index, which must be less than count.
+         * This may canonicalize the symbol into *buf.
+         */
+        const Sym<> &get(size_t index, Sym<> *buf) const
+        {
+                return *view_hdr(buf, data + index * stride,
+                                 f.get_hdr().ei_class, f.get_hdr().ei_data);
+        }
+
+        /**
+         * Return whether the symbol at index, which must be less than
+         * count, is named name.
+         */
+        bool is_named(size_t index, const char *name) const
+        {
+                Sym<> buf;
+                return strcmp(strs.get(get(index, &buf).name, nullptr),
+                              name) == 0;
+        }
+
+        void find_hashes();
+        void build_names();
 };
 
 symtab::symtab(elf f, const void *data, size_t size, strtab strs)
@@ -384,13 +891,49 @@ symtab::symtab(elf f, const void *data, size_t size, strtab strs)
 {
 }
 
+void
+symtab::impl::find_hashes()
+{
+        auto secs = f.sections();
+        for (auto &sec : secs) {
+                auto &hdr = sec.get_hdr();
+                if (hdr.type != sht::gnu_hash && hdr.type != sht::hash)
+                        continue;
+                if (hdr.link >= secs.size() || secs[hdr.link].data() != data)
+                        continue;
+                // Prefer the GNU hash table, which has a bloom filter
+                if (hdr.type == sht::gnu_hash)
+                        gnu = sec.as_gnu_hash();
+                else
+                        sysv = sec.as_hash();
+        }
+}
+
+void
+symtab::impl::build_names()
+{
+        names.reserve(count);
+        Sym<> buf, buf2;
+        for (size_t i = 1; i < count; i++) {
+                const Sym<> &sym = get(i, &buf);
+                size_t len;
+                const char *name = strs.get(sym.name, &len);
+                if (len == 0)
+                        continue;
+                // Prefer defined symbols over undefined references to
+                // the same name
+                auto res = names.emplace(string_view(name, len), i);
+                if (!res.second && sym.shnxd != shn::undef &&
+                    get(res.first->second, &buf2).shnxd == shn::undef)
+                        res.first->second = i;
+        }
+}
+
 symtab::iterator::iterator(const symtab &tab, const char *pos)
-        : f(tab.m->f), strs(tab.m->strs), pos(pos)
+        : strs(tab.m->strs), pos(pos), stride(tab.m->stride),
+          ei_class(tab.m->f.get_hdr().ei_class),
+          ei_data(tab.m->f.get_hdr().ei_data)
 {
-        if (f.get_hdr().ei_class == elfclass::_32)
-                stride = sizeof(Sym<Elf32>);
-        else
-                stride = sizeof(Sym<Elf64>);
 }
 
 symtab::iterator
@@ -405,4 +948,466 @@ symtab::end() const
         return iterator(*this, m->end);
 }
 
+symtab::iterator
+symtab::lookup(const char *name) const
+{
+        call_once(m->hashes_once, [&] { m->find_hashes(); });
+
+        size_t index;
+        if (m->gnu.valid()) {
+                index = m->gnu.lookup(*this, name);
+        } else if (m->sysv.valid()) {
+                index = m->sysv.lookup(*this, name);
+        } else {
+                call_once(m->names_once, [&] { m->build_names(); });
+                auto it = m->names.find(name);
+                index = it == m->names.end() ? 0 : it->second;
+        }
+
+        if (index == 0)
+                return end();
+        return iterator(*this, m->data + index * m->stride);
+}
+
+// Read a size-byte word in the byte order of f
+static uint64_t
+read_word(const elf &f, const char *data, size_t size)
+{
+        const unsigned char *p = (const unsigned char*)data;
+        uint64_t val = 0;
+        if (f.get_hdr().ei_data == elfdata::msb) {
+                for (size_t i = 0; i < size; i++)
+                        val = (val << 8) | p[i];
+        } else {
+                for (size_t i = size; i > 0; i--)
+                        val = (val << 8) | p[i - 1];
+        }
+        return val;
+}
+
+//////////////////////////////////////////////////////////////////
+// class sysv_hash
+//
+
+struct sysv_hash::impl
+{
+        impl(const elf &f) : f(f) { }
+
+        const elf f;
+        const char *data;
+        size_t entsize;
+        uint64_t nbucket, nchain;
+
+        // Return entry index, counting the two header entries
+        uint64_t entry(uint64_t index) const
+        {
+                return read_word(f, data + index * entsize, entsize);
+        }
+};
+
+sysv_hash::sysv_hash(elf f, const void *data, size_t size, size_t entsize)
+        : m(make_shared<impl>(f))
+{
+        if (entsize != 4 && entsize != 8)
+                throw format_error("bad hash table entry size " +
+                                   std::to_string(entsize));
+        m->data = (const char*)data;
+        m->entsize = entsize;
+        if (size < 2 * entsize)
+                throw format_error("hash table header exceeds section size");
+        m->nbucket = m->entry(0);
+        m->nchain = m->entry(1);
+        if (m->nbucket == 0 ||
+            m->nbucket > size / entsize - 2 ||
+            m->nchain > size / entsize - 2 - m->nbucket)
+                throw format_error("hash table exceeds section size");
+}
+
+uint32_t
+sysv_hash::hash(const char *name)
+{
+        uint32_t h = 0;
+        for (const unsigned char *p = (const unsigned char*)name; *p; p++) {
+                h = (h << 4) + *p;
+                uint32_t g = h & 0xf0000000;
+                if (g)
+                        h ^= g >> 24;
+                h &= ~g;
+        }
+        return h;
+}
+
+size_t
+sysv_hash::lookup(const symtab &syms, const char *name) const
+{
+        const symtab::impl &t = *syms.m;
+        uint64_t index = m->entry(2 + hash(name) % m->nbucket);
+        // Bound the walk in case the chain is cyclic
+        for (uint64_t n = 0; index != 0 && n < m->nchain; n++) {
+                if (index >= m->nchain || index >= t.count)
+                        break;
+                if (t.is_named(index, name))
+                        return index;
+                index = m->entry(2 + m->nbucket + index);
+        }
+        return 0;
+}
+
+//////////////////////////////////////////////////////////////////
+// class gnu_hash
+//
+
+struct gnu_hash::impl
+{
+        impl(const elf &f) : f(f) { }
+
+        const elf f;
+        GnuHash<> hdr;
+        // Size of a bloom filter word in bytes
+        size_t word;
+        const char *bloom, *buckets, *chains;
+        size_t nchains;
+};
+
+gnu_hash::gnu_hash(elf f, const void *data, size_t size)
+        : m(make_shared<impl>(f))
+{
+        auto &ehdr = f.get_hdr();
+        if (size < sizeof(GnuHash<Elf32>))
+                throw format_error("gnu_hash header exceeds section size");
+        canon_hdr(&m->hdr, data, ehdr.ei_class, ehdr.ei_data);
+        m->word = ehdr.ei_class == elfclass::_32 ? 4 : 8;
+        if (m->hdr.nbuckets == 0 || m->hdr.bloom_size == 0)
+                throw format_error("gnu_hash table has no buckets");
+        if (m->hdr.bloom_shift >= 32)
+                throw format_error("bad gnu_hash bloom shift " +
+                                   std::to_string(m->hdr.bloom_shift));
+        size_t avail = size - sizeof(GnuHash<Elf32>);
+        if (m->hdr.bloom_size > avail / m->word)
+                throw format_error("gnu_hash table exceeds section size");
+        avail -= m->hdr.bloom_size * m->word;
+        if (m->hdr.nbuckets > avail / 4)
+                throw format_error("gnu_hash table exceeds section size");
+        avail -= m->hdr.nbuckets * 4;
+
+        m->bloom = (const char*)data + sizeof(GnuHash<Elf32>);
+        m->buckets = m->bloom + m->hdr.bloom_size * m->word;
+        m->chains = m->buckets + m->hdr.nbuckets * 4;
+        m->nchains = avail / 4;
+}
+
+uint32_t
+gnu_hash::hash(const char *name)
+{
+        uint32_t h = 5381;
+        for (const unsigned char *p = (const unsigned char*)name; *p; p++)
+                h = h * 33 + *p;
+        return h;
+}
+
+size_t
+gnu_hash::lookup(const symtab &syms, const char *name) const
+{
+        const symtab::impl &t = *syms.m;
+        const GnuHash<> &hdr = m->hdr;
+        uint32_t h = hash(name);
+
+        // Check the bloom filter
+        unsigned bits = m->word * 8;
+        const char *bloom = m->bloom + (h / bits % hdr.bloom_size) * m->word;
+        uint64_t word = read_word(m->f, bloom, m->word);
+        uint64_t mask = ((uint64_t)1 << (h % bits)) |
+                ((uint64_t)1 << ((h >> hdr.bloom_shift) % bits));
+        if ((word & mask) != mask)
+                return 0;
+
+        // Walk the chain, which ends at an entry with the low bit set
+        uint64_t index = read_word(m->f, m->buckets + h % hdr.nbuckets * 4,
+                                   4);
+        if (index < hdr.symoffset)
+                return 0;
+        for (; index - hdr.symoffset < m->nchains && index < t.count; index++) {
+                uint32_t h2 = read_word(m->f, m->chains +
+                                        (index - hdr.symoffset) * 4, 4);
+                if ((h | 1) == (h2 | 1) && t.is_named(index, name))
+                        return index;
+                if (h2 & 1)
+                        break;
+        }
+        return 0;
+}
+
+//////////////////////////////////////////////////////////////////
+// class symbol_index
+//
+
+struct symbol_index::impl
+{
+        vector<entry> entries;
+        // String tables of the indexed symbol tables, by entry::table
+        vector<strtab> strtabs;
+        // The files of those tables.  Symbol tables only hold
+        // borrowed handles to their file, so these keep the string
+        // table data loaded.
+        elf f, mini;
+};
+
+symbol_index::symbol_index(const elf &f)
+        : m(make_shared<impl>())
+{
+        m->f = f;
+        bool have_symtab = false;
+        for (auto &sec : f.sections()) {
+                if (sec.get_hdr().type == sht::symtab)
+                        have_symtab = true;
+                if (sec.get_hdr().type == sht::symtab ||
+                    sec.get_hdr().type == sht::dynsym)
+                        add(sec.as_symtab());
+        }
+        if (have_symtab)
+                return;
+
+        // Stripped binaries may keep their full symbol table in
+        // MiniDebugInfo.  This is only extra information, so a
+        // missing or undecodable image just leaves it out.
+        elf &mini = m->mini;
+        try {
+                mini = open_gnu_debugdata(f);
+        } catch (format_error &e) {
+                return;
+        }
+        if (!mini.valid())
+                return;
+        for (auto &sec : mini.sections())
+                if (sec.get_hdr().type == sht::symtab)
+                        add(sec.as_symtab());
+}
+
+// Rank bindings so that the preferred alias sorts first
+static int
+binding_rank(stb binding)
+{
+        switch (binding) {
+        case stb::global:
+                return 0;
+        case stb::weak:
+                return 1;
+        default:
+                return 2;
+        }
+}
+
+void
+symbol_index::add(const symtab &tab)
+{
+        const symtab::impl &t = *tab.m;
+        if (m->strtabs.size() > 0xFF)
+                throw std::length_error("too many symbol tables in index");
+        unsigned char table = m->strtabs.size();
+        m->strtabs.push_back(t.strs);
+
+        auto &hdr = t.f.get_hdr();
+        size_t stride = hdr.ei_class == elfclass::_32 ?
+                sizeof(Sym<Elf32>) : sizeof(Sym<Elf64>);
+        Sym<> buf;
+        for (const char *pos = t.data; pos + stride <= t.end; pos += stride) {
+                const Sym<> &sym = *view_hdr(&buf, pos, hdr.ei_class,
+                                             hdr.ei_data);
+                if (sym.type() != stt::func && sym.type() != stt::object)
+                        continue;
+                if (sym.shnxd == shn::undef)
+                        continue;
+                m->entries.push_back({sym.value, sym.size, sym.name,
+                                      sym.info, table});
+        }
+
+        // Sort by address, with aliases ordered by preference, and
+        // drop all but the first of each group of aliases.
+        auto &entries = m->entries;
+        sort(entries.begin(), entries.end(),
+             [](const entry &a, const entry &b) {
+                     if (a.value != b.value)
+                             return a.value < b.value;
+                     if (a.size != b.size)
+                             return a.size < b.size;
+                     if (a.type() != b.type())
+                             return a.type() < b.type();
+                     if (a.binding() != b.binding())
+                             return binding_rank(a.binding()) <
+                                     binding_rank(b.binding());
+                     return a.table < b.table;
+             });
+        entries.erase(unique(entries.begin(), entries.end(),
+                             [](const entry &a, const entry &b) {
+                                     return a.value == b.value &&
+                                             a.size == b.size &&
+                                             a.type() == b.type();
+                             }),
+                      entries.end());
+        entries.shrink_to_fit();
+}
+
+static bool
+contains(const symbol_index::entry &e, Elf64::Addr addr)
+{
+        return addr - e.value < e.size || addr == e.value;
+}
+
+const symbol_index::entry *
+symbol_index::find(Elf64::Addr addr) const
+{
+        auto &entries = m->entries;
+        auto it = upper_bound(entries.begin(), entries.end(), addr,
+                              [](Elf64::Addr a, const entry &e) {
+                                      return a < e.value;
+                              });
+        if (it == entries.begin())
+                return nullptr;
+        --it;
+        return contains(*it, addr) ? &*it : nullptr;
+}
+
+void
+symbol_index::find(const Elf64::Addr *addrs, size_t count,
+                   const entry **out) const
+{
+        const entry *begin = m->entries.data();
+        const entry *end = begin + m->entries.size();
+        // e is always the first entry past the current address
+        const entry *e = begin;
+        for (size_t i = 0; i < count; i++) {
+                while (e != end && e->value <= addrs[i])
+                        ++e;
+                if (e != begin && contains(e[-1], addrs[i]))
+                        out[i] = &e[-1];
+                else
+                        out[i] = nullptr;
+        }
+}
+
+const char *
+symbol_index::get_name(const entry &e, size_t *len_out) const
+{
+        return m->strtabs[e.table].get(e.name, len_out);
+}
+
+std::string
+symbol_index::get_name(const entry &e) const
+{
+        return m->strtabs[e.table].get(e.name);
+}
+
+std::string_view
+symbol_index::get_name_view(const entry &e) const
+{
+        return m->strtabs[e.table].get_view(e.name);
+}
+
+const symbol_index::entry *
+symbol_index::begin() const
+{
+        return m->entries.data();
+}
+
+const symbol_index::entry *
+symbol_index::end() const
+{
+        return m->entries.data() + m->entries.size();
+}
+
+size_t
+symbol_index::size() const
+{
+        return m->entries.size();
+}
+
+//////////////////////////////////////////////////////////////////
+// class note
+//
+
+static uint64_t
+note_align(uint64_t size, unsigned align)
+{
+        return (size + align - 1) & ~(uint64_t)(align - 1);
+}
+
+note::note(elfdata ei_data, const void *data, unsigned align)
+{
+        // The note header has the same layout in both classes
+        canon_hdr(&hdr, data, elfclass::_64, ei_data);
+        name = (const char*)data + sizeof(Nhdr<>);
+        desc = name + note_align(hdr.namesz, align);
+        if (hdr.namesz == 0 || name[hdr.namesz - 1] != '\0')
+                name = "";
+}
+
+//////////////////////////////////////////////////////////////////
+// class notes
+//
+
+struct notes::impl
+{
+        impl(const elf &f, const char *data, const char *end, unsigned align)
+                : f(f), data(data), end(end), align(align) { }
+
+        const elf f;
+        const char *data, *end;
+        const unsigned align;
+};
+
+notes::notes(elf f, const void *data, size_t size, size_t align)
+        : m(make_shared<impl>(f, (const char*)data, (const char*)data + size,
+                              // Most producers align notes to 4 bytes
+                              // even in ELF64 files
+                              align == 8 ? 8 : 4))
+{
+}
+
+notes::iterator::iterator(const notes &n, const char *pos)
+        : pos(pos), end(n.m->end), align(n.m->align),
+          ei_data(n.m->f.get_hdr().ei_data)
+{
+        this->pos = check(pos);
+}
+
+const char *
+notes::iterator::check(const char *pos) const
+{
+        if ((size_t)(end - pos) < sizeof(Nhdr<>))
+                return end;
+        Nhdr<> hdr{};
+        canon_hdr(&hdr, pos, elfclass::_64, ei_data);
+        // The final note's descriptor need not be padded
+        if (sizeof(Nhdr<>) + note_align(hdr.namesz, align) + hdr.descsz >
+            (uint64_t)(end - pos))
+                return end;
+        return pos;
+}
+
+notes::iterator &
+notes::iterator::operator++()
+{
+        Nhdr<> hdr{};
+        canon_hdr(&hdr, pos, elfclass::_64, ei_data);
+        uint64_t len = sizeof(Nhdr<>) + note_align(hdr.namesz, align) +
+                note_align(hdr.descsz, align);
+        if (len >= (uint64_t)(end - pos))
+                pos = end;
+        else
+                pos = check(pos + len);
+        return *this;
+}
+
+notes::iterator
+notes::begin() const
+{
+        return iterator(*this, m->data);
+}
+
+notes::iterator
+notes::end() const
+{
+        return iterator(*this, m->end);
+}
+
 ELFPP_END_NAMESPACE
@@ -0,0 +1,125 @@
+// Copyright (c) 2026 Huawei Technologies Co. All rights reserved.
+// Use of this source code is governed by an MIT license
+// that can be found in the LICENSE file.
+
+#include "elf++.hh"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#ifdef ELFPP_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+using namespace std;
+
+ELFPP_BEGIN_NAMESPACE
+
+typedef shared_ptr<const vector<char> > image;
+
+// Decompressed MiniDebugInfo images, most recently used first, keyed
+// by the build ID of the file they came from
+static constexpr size_t image_cache_size = 64;
+static mutex image_cache_lock;
+static list<pair<string, image> > image_cache;
+
+/**
+ * Return the cached image for key and make it the most recently
+ * used, or return nullptr.  The caller must hold image_cache_lock.
+ */
+static image
+cache_lookup(const string &key)
+{
+        for (auto it = image_cache.begin(); it != image_cache.end(); ++it) {
+                if (it->first == key) {
+                        image_cache.splice(image_cache.begin(), image_cache,
+                                           it);
+                        return it->second;
+                }
+        }
+        return nullptr;
+}
+
+// Limits on decompressing MiniDebugInfo, so a small hostile section
+// can't exhaust memory.  Symbol tables compress far worse than
+// max_ratio, and xz -9 needs less than max_decoder_memory to decode.
+static constexpr size_t max_ratio = 1024;
+static constexpr size_t max_image_size = (size_t)1 << 30;
+static constexpr uint64_t max_decoder_memory = 128 << 20;
+
+/**
+ * Decompress the xz stream of size bytes at data.  Throws
+ * format_error if the stream is malformed or would exceed the limits
+ * above.
+ */
+static image
+unxz(const void *data, size_t size)
+{
+#ifdef ELFPP_HAVE_LZMA
+        lzma_stream strm = LZMA_STREAM_INIT;
+        if (lzma_stream_decoder(&strm, max_decoder_memory, 0) != LZMA_OK)
+                throw format_error("cannot initialize xz decoder");
+        size_t limit = size > max_image_size / max_ratio ?
+                max_image_size : size * max_ratio;
+        auto out = make_shared<vector<char> >();
+        strm.next_in = (const uint8_t*)data;
+        strm.avail_in = size;
+        lzma_ret ret;
+        do {
+                size_t done = out->size();
+                if (done == limit) {
+                        ret = LZMA_DATA_ERROR;
+                        break;
+                }
+                out->resize(min(max(done * 2, (size_t)65536), limit));
+                strm.next_out = (uint8_t*)out->data() + done;
+                strm.avail_out = out->size() - done;
+                ret = lzma_code(&strm, LZMA_FINISH);
+                out->resize(out->size() - strm.avail_out);
+        } while (ret == LZMA_OK);
+        lzma_end(&strm);
+        if (ret != LZMA_STREAM_END)
+                throw format_error("malformed .gnu_debugdata section");
+        out->shrink_to_fit();
+        return out;
+#else
+        throw format_error("cannot decompress .gnu_debugdata without xz support");
+#endif
+}
+
+elf
+open_gnu_debugdata(const elf &f)
+{
+        auto &sec = f.get_section(".gnu_debugdata");
+        if (!sec.valid() || !sec.data())
+                return elf();
+
+        size_t id_size;
+        const void *id = f.get_build_id(&id_size);
+        string key = id ? string((const char*)id, id_size) : string();
+
+        image img;
+        if (!key.empty()) {
+                lock_guard<mutex> guard(image_cache_lock);
+                img = cache_lookup(key);
+        }
+
+        if (!img) {
+                img = unxz(sec.data(), sec.size());
+                if (!key.empty()) {
+                        lock_guard<mutex> guard(image_cache_lock);
+                        // Another thread may have decompressed it
+                        // meanwhile
+                        if (!cache_lookup(key))
+                                image_cache.emplace_front(key, img);
+                        if (image_cache.size() > image_cache_size)
+                                image_cache.pop_back();
+                }
+        }
+
+        return elf(create_memory_loader(img->data(), img->size(), img));
+}
+
+ELFPP_END_NAMESPACE
@@ -0,0 +1,41 @@
+// Copyright (c) 2026 Huawei Technologies Co. All rights reserved.
+// Use of this source code is governed by an MIT license
+// that can be found in the LICENSE file.
+
+#include "elf++.hh"
+
+using namespace std;
+
+ELFPP_BEGIN_NAMESPACE
+
+class memory_loader : public loader
+{
+        const char *base;
+        size_t lim;
+        shared_ptr<const void> keepalive;
+
+public:
+        memory_loader(const void *data, size_t size,
+                      shared_ptr<const void> keepalive)
+                : base((const char*)data), lim(size),
+                  keepalive(move(keepalive))
+        {
+        }
+
+        const void *load(off_t offset, size_t size)
+        {
+                if (offset < 0 || (size_t)offset > lim ||
+                    size > lim - offset)
+                        throw range_error("offset exceeds image size");
+                return base + offset;
+        }
+};
+
+std::shared_ptr<loader>
+create_memory_loader(const void *data, size_t size,
+                     std::shared_ptr<const void> keepalive)
+{
+        return make_shared<memory_loader>(data, size, move(keepalive));
+}
+
+ELFPP_END_NAMESPACE
@@ -4,6 +4,7 @@
 
 #include "elf++.hh"
 
+#include <algorithm>
 #include <system_error>
 
 #include <sys/types.h>
@@ -22,20 +23,42 @@ class mmap_loader : public loader
         void *base;
         size_t lim;
 
+        /**
+         * Apply madvise advice to the pages covering the given range.
+         * This is only a hint, so failures are ignored.
+         */
+        void madvise_range(off_t offset, size_t size, int advice)
+        {
+                if (offset < 0 || (size_t)offset >= lim || size == 0)
+                        return;
+                size = min(size, lim - offset);
+                size_t page = sysconf(_SC_PAGESIZE);
+                size_t start = offset & ~(page - 1);
+                madvise((char*)base + start, offset + size - start, advice);
+        }
+
 public:
-        mmap_loader(int fd)
+        mmap_loader(int fd, bool populate, bool owns_fd)
         {
-                off_t end = lseek(fd, 0, SEEK_END);
-                if (end == (off_t)-1)
+                // Use fstat rather than seeking so a borrowed fd's file
+                // offset is left alone
+                struct stat st;
+                if (fstat(fd, &st) < 0)
                         throw system_error(errno, system_category(),
                                            "finding file length");
-                lim = end;
+                lim = st.st_size;
 
-                base = mmap(nullptr, lim, PROT_READ, MAP_SHARED, fd, 0);
+                int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+                if (populate)
+                        flags |= MAP_POPULATE;
+#endif
+                base = mmap(nullptr, lim, PROT_READ, flags, fd, 0);
                 if (base == MAP_FAILED)
                         throw system_error(errno, system_category(),
                                            "mmap'ing file");
-                close(fd);
+                if (owns_fd)
+                        close(fd);
         }
 
         ~mmap_loader()
@@ -49,12 +72,43 @@ public:
                         throw range_error("offset exceeds file size");
                 return (const char*)base + offset;
         }
+
+        void prefetch(off_t offset, size_t size)
+        {
+                madvise_range(offset, size, MADV_WILLNEED);
+        }
+
+        void advise(off_t offset, size_t size, access_pattern pattern)
+        {
+                int advice;
+                switch (pattern) {
+                case access_pattern::sequential:
+                        advice = MADV_SEQUENTIAL;
+                        break;
+                case access_pattern::random:
+                        advice = MADV_RANDOM;
+                        break;
+                case access_pattern::willneed:
+                        advice = MADV_WILLNEED;
+                        break;
+                default:
+                        advice = MADV_NORMAL;
+                        break;
+                }
+                madvise_range(offset, size, advice);
+        }
 };
 
 std::shared_ptr<loader>
-create_mmap_loader(int fd)
+create_mmap_loader(int fd, bool populate)
+{
+        return make_shared<mmap_loader>(fd, populate, true);
+}
+
+std::shared_ptr<loader>
+create_borrowed_mmap_loader(int fd, bool populate)
 {
-        return make_shared<mmap_loader>(fd);
+        return make_shared<mmap_loader>(fd, populate, false);
 }
 
 ELFPP_END_NAMESPACE
@@ -0,0 +1,259 @@
+// Copyright (c) 2026 Huawei Technologies Co. All rights reserved.
+// Use of this source code is governed by an MIT license
+// that can be found in the LICENSE file.
+
+#include "elf++.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+ELFPP_BEGIN_NAMESPACE
+
+class pread_loader : public loader
+{
+        struct buffer
+        {
+                unique_ptr<char[]> data;
+                // Number of load calls not yet released.  Prefetched
+                // buffers start at zero.
+                unsigned refs;
+                // False while the range is still being read
+                bool ready;
+        };
+
+        const int fd;
+        size_t lim;
+
+        mutex lock;
+        // Signaled when a buffer becomes ready or a read fails
+        condition_variable done;
+        // Loaded ranges, by (offset, size)
+        map<pair<off_t, size_t>, buffer> buffers;
+        // The range of each loaded buffer, by address
+        unordered_map<const void*, pair<off_t, size_t> > ranges;
+
+        // Prefetch workers and the ranges waiting for them
+        vector<thread> workers;
+        deque<pair<off_t, size_t> > queue;
+        condition_variable work;
+        bool stopping;
+
+        /**
+         * Read size bytes at offset into data.
+         */
+        void read_range(char *data, off_t offset, size_t size)
+        {
+                size_t done = 0;
+                while (done < size) {
+                        ssize_t n = pread(fd, data + done, size - done,
+                                          offset + done);
+                        if (n < 0 && errno == EINTR)
+                                continue;
+                        if (n < 0)
+                                throw system_error(errno, system_category(),
+                                                   "reading file");
+                        if (n == 0)
+                                throw range_error("unexpected end of file");
+                        done += n;
+                }
+        }
+
+        /**
+         * Add a buffer for the given range that is not yet ready.
+         * The caller must hold lock.
+         */
+        buffer &start(const pair<off_t, size_t> &key, unsigned refs)
+        {
+                // Allocate at least one byte so every range has a
+                // distinct address
+                auto &buf = buffers[key];
+                buf.data.reset(new char[key.second ? key.second : 1]);
+                buf.refs = refs;
+                buf.ready = false;
+                return buf;
+        }
+
+        /**
+         * Fill in the buffer for key, which start returned, without
+         * holding lock, and mark it ready.  On failure, drop the
+         * buffer so a later load retries the read, and rethrow.
+         */
+        void fill(unique_lock<mutex> &guard, const pair<off_t, size_t> &key,
+                  buffer &buf)
+        {
+                char *data = buf.data.get();
+                guard.unlock();
+                try {
+                        read_range(data, key.first, key.second);
+                } catch (...) {
+                        guard.lock();
+                        buffers.erase(key);
+                        done.notify_all();
+                        throw;
+                }
+                guard.lock();
+                ranges.emplace(data, key);
+                buf.ready = true;
+                done.notify_all();
+        }
+
+        void worker()
+        {
+                unique_lock<mutex> guard(lock);
+                while (true) {
+                        work.wait(guard, [&]{
+                                return stopping || !queue.empty();
+                        });
+                        if (stopping)
+                                return;
+                        auto key = queue.front();
+                        queue.pop_front();
+                        try {
+                                fill(guard, key, buffers.at(key));
+                        } catch (...) {
+                                // load will retry and report the error
+                        }
+                }
+        }
+
+public:
+        pread_loader(int fd, unsigned threads)
+                : fd(fd), stopping(false)
+        {
+                struct stat st;
+                if (fstat(fd, &st) < 0) {
+                        int err = errno;
+                        close(fd);
+                        throw system_error(err, system_category(),
+                                           "finding file length");
+                }
+                lim = st.st_size;
+
+                for (unsigned i = 0; i < threads; i++)
+                        workers.emplace_back(&pread_loader::worker, this);
+        }
+
+        ~pread_loader()
+        {
+                {
+                        lock_guard<mutex> guard(lock);
+                        stopping = true;
+                }
+                work.notify_all();
+                for (auto &t : workers)
+                        t.join();
+                close(fd);
+        }
+
+        const void *load(off_t offset, size_t size)
+        {
+                if (offset < 0 || (size_t)offset > lim ||
+                    size > lim - offset)
+                        throw range_error("offset exceeds file size");
+
+                unique_lock<mutex> guard(lock);
+                auto key = make_pair(offset, size);
+                while (true) {
+                        auto it = buffers.find(key);
+                        if (it == buffers.end())
+                                break;
+                        if (it->second.ready) {
+                                it->second.refs++;
+                                return it->second.data.get();
+                        }
+                        // Wait for a prefetch or another load of this
+                        // range to finish
+                        done.wait(guard);
+                }
+
+                auto &buf = start(key, 1);
+                fill(guard, key, buf);
+                return buf.data.get();
+        }
+
+        void prefetch(off_t offset, size_t size)
+        {
+                if (workers.empty())
+                        return;
+                if (offset < 0 || (size_t)offset > lim ||
+                    size > lim - offset)
+                        return;
+
+                auto key = make_pair(offset, size);
+                {
+                        lock_guard<mutex> guard(lock);
+                        if (buffers.count(key))
+                                return;
+                        start(key, 0);
+                        queue.push_back(key);
+                }
+                work.notify_one();
+        }
+
+        void advise(off_t offset, size_t size, access_pattern pattern)
+        {
+                // pread goes through the page cache, so pass the hint
+                // on to the kernel's readahead
+                int advice;
+                switch (pattern) {
+                case access_pattern::sequential:
+                        advice = POSIX_FADV_SEQUENTIAL;
+                        break;
+                case access_pattern::random:
+                        advice = POSIX_FADV_RANDOM;
+                        break;
+                case access_pattern::willneed:
+                        advice = POSIX_FADV_WILLNEED;
+                        break;
+                default:
+                        advice = POSIX_FADV_NORMAL;
+                        break;
+                }
+                posix_fadvise(fd, offset, size, advice);
+        }
+
+        void release(const void *data, size_t size)
+        {
+                lock_guard<mutex> guard(lock);
+                auto it = ranges.find(data);
+                if (it == ranges.end() || it->second.second != size)
+                        return;
+                auto buf = buffers.find(it->second);
+                if (buf->second.refs == 0)
+                        return;
+                if (--buf->second.refs == 0) {
+                        buffers.erase(buf);
+                        ranges.erase(it);
+                }
+        }
+};
+
+std::shared_ptr<loader>
+create_pread_loader(int fd)
+{
+        return make_shared<pread_loader>(fd, 0);
+}
+
+std::shared_ptr<loader>
+create_async_loader(int fd, unsigned threads)
+{
+        if (threads == 0)
+                threads = 1;
+        return make_shared<pread_loader>(fd, threads);
+}
+
+ELFPP_END_NAMESPACE
@@ -71,6 +71,7 @@ to_string(sht v)
         case sht::shlib: return "shlib";
         case sht::dynsym: return "dynsym";
         case sht::loos: break;
+        case sht::gnu_hash: return "gnu_hash";
         case sht::hios: break;
         case sht::loproc: break;
         case sht::hiproc: break;
@@ -85,6 +86,7 @@ to_string(shf v)
         if ((v & shf::write) == shf::write) { res += "write|"; v &= ~shf::write; }
         if ((v & shf::alloc) == shf::alloc) { res += "alloc|"; v &= ~shf::alloc; }
         if ((v & shf::execinstr) == shf::execinstr) { res += "execinstr|"; v &= ~shf::execinstr; }
+        if ((v & shf::compressed) == shf::compressed) { res += "compressed|"; v &= ~shf::compressed; }
         if ((v & shf::maskos) == shf::maskos) { res += "maskos|"; v &= ~shf::maskos; }
         if ((v & shf::maskproc) == shf::maskproc) { res += "maskproc|"; v &= ~shf::maskproc; }
         if (res.empty() || v != (shf)0) res += "(shf)0x" + to_hex((int)v);
@@ -92,6 +94,20 @@ to_string(shf v)
         return res;
 }
 
+std::string
+to_string(elfcompress v)
+{
+        switch (v) {
+        case elfcompress::zlib: return "zlib";
+        case elfcompress::zstd: return "zstd";
+        case elfcompress::loos: break;
+        case elfcompress::hios: break;
+        case elfcompress::loproc: break;
+        case elfcompress::hiproc: break;
+        }
+        return "(elfcompress)0x" + to_hex((int)v);
+}
+
 std::string
 to_string(pt v)
 {
@@ -125,6 +141,34 @@ to_string(pf v)
         return res;
 }
 
+std::string
+to_string(nt v)
+{
+        switch (v) {
+        case nt::prstatus: return "prstatus";
+        case nt::prfpreg: return "prfpreg";
+        case nt::prpsinfo: return "prpsinfo";
+        case nt::taskstruct: return "taskstruct";
+        case nt::auxv: return "auxv";
+        case nt::siginfo: return "siginfo";
+        case nt::file: return "file";
+        }
+        return "(nt)0x" + to_hex((int)v);
+}
+
+std::string
+to_string(nt_gnu v)
+{
+        switch (v) {
+        case nt_gnu::abi_tag: return "abi_tag";
+        case nt_gnu::hwcap: return "hwcap";
+        case nt_gnu::build_id: return "build_id";
+        case nt_gnu::gold_version: return "gold_version";
+        case nt_gnu::property_type_0: return "property_type_0";
+        }
+        return "(nt_gnu)0x" + to_hex((int)v);
+}
+
 std::string
 to_string(stb v)
 {
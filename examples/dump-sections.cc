@@ -27,8 +27,9 @@ int main(int argc, char **argv)
                "Size", "EntSize", "Flags", "Link", "Info", "Align");
         for (auto &sec : f.sections()) {
                 auto &hdr = sec.get_hdr();
-                printf("  [%2d] %-16s %-16s %016" PRIx64 " %08" PRIx64 "\n", i++,
-                       sec.get_name().c_str(),
+                auto name = sec.get_name_view();
+                printf("  [%2d] %-16.*s %-16s %016" PRIx64 " %08" PRIx64 "\n", i++,
+                       (int)name.size(), name.data(),
                        to_string(hdr.type).c_str(),
                        hdr.addr, hdr.offset);
                 printf("       %016zx %016" PRIx64 " %-15s %5s %4d %5" PRIu64 "\n",
@@ -24,19 +24,22 @@ int main(int argc, char **argv)
                 if (sec.get_hdr().type != elf::sht::symtab && sec.get_hdr().type != elf::sht::dynsym)
                         continue;
 
-                printf("Symbol table '%s':\n", sec.get_name().c_str());
+                auto secname = sec.get_name_view();
+                printf("Symbol table '%.*s':\n",
+                       (int)secname.size(), secname.data());
                 printf("%6s: %-16s %-5s %-7s %-7s %-5s %s\n",
                        "Num", "Value", "Size", "Type", "Binding", "Index",
                        "Name");
                 int i = 0;
                 for (auto sym : sec.as_symtab()) {
                         auto &d = sym.get_data();
-                        printf("%6d: %016" PRIx64 " %5" PRId64 " %-7s %-7s %5s %s\n",
+                        auto name = sym.get_name_view();
+                        printf("%6d: %016" PRIx64 " %5" PRId64 " %-7s %-7s %5s %.*s\n",
                                i++, d.value, d.size,
                                to_string(d.type()).c_str(),
                                to_string(d.binding()).c_str(),
                                to_string(d.shnxd).c_str(),
-                               sym.get_name().c_str());
+                               (int)name.size(), name.data());
                 }
         }
 
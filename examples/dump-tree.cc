@@ -8,17 +8,20 @@
 using namespace std;
 
 void
-dump_tree(const dwarf::die &node, int depth = 0)
+dump_tree(const dwarf::unit &u)
 {
-        printf("%*.s<%" PRIx64 "> %s\n", depth, "",
-               node.get_section_offset(),
-               to_string(node.tag).c_str());
-        for (auto &attr : node.attributes())
-                printf("%*.s      %s %s\n", depth, "",
-                       to_string(attr.first).c_str(),
-                       to_string(attr.second).c_str());
-        for (auto &child : node)
-                dump_tree(child, depth + 1);
+        // Read the unit front to back rather than recursing
+        auto dies = u.dfs();
+        for (auto it = dies.begin(); it != dies.end(); ++it) {
+                int depth = it.depth();
+                printf("%*.s<%" PRIx64 "> %s\n", depth, "",
+                       it->get_section_offset(),
+                       to_string(it->tag).c_str());
+                for (auto &attr : it->attributes())
+                        printf("%*.s      %s %s\n", depth, "",
+                               to_string(attr.first).c_str(),
+                               to_string(attr.second).c_str());
+        }
 }
 
 int
@@ -37,10 +40,26 @@ main(int argc, char **argv)
 
         elf::elf ef(elf::create_mmap_loader(fd));
         dwarf::dwarf dw(dwarf::elf::create_loader(ef));
+        // Split units are looked up in the file's package first
+        dw.set_package_path(string(argv[1]) + ".dwp");
+        // Every DIE is visited once, in order
+        dw.advise(dwarf::section_type::info, dwarf::access_pattern::sequential);
 
         for (auto cu : dw.compilation_units()) {
                 printf("--- <%" PRIx64 ">\n", cu.get_section_offset());
-                dump_tree(cu.root());
+                dump_tree(cu);
+                // With split DWARF, the DIEs are in a .dwo file,
+                // which may be missing
+                if (!cu.is_skeleton())
+                        continue;
+                dwarf::compilation_unit split;
+                try {
+                        split = cu.get_split_unit();
+                } catch (dwarf::format_error &e) {
+                        fprintf(stderr, "%s: %s\n", argv[1], e.what());
+                        continue;
+                }
+                dump_tree(split);
         }
 
         return 0;
@@ -0,0 +1,120 @@
+// Benchmark die::attributes() by walking every attribute of every DIE
+// of an ELF file, both through the range and by first copying the
+// attributes into a vector, as attributes() used to return.  It fails
+// if iterating over the range allocates anything beyond what walking
+// the DIEs does.  This is built with the tests but not run by
+// test.sh, since it needs a large input to say anything.
+
+#include "elf++.hh"
+#include "dwarf++.hh"
+
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+static size_t allocations;
+
+void *
+operator new(size_t size)
+{
+        allocations++;
+        if (void *p = malloc(size ? size : 1))
+                return p;
+        throw bad_alloc();
+}
+
+void
+operator delete(void *p) noexcept
+{
+        free(p);
+}
+
+void
+operator delete(void *p, size_t) noexcept
+{
+        free(p);
+}
+
+// Run visit on every DIE passes times and return the allocations per
+// pass
+template<typename Visit>
+static size_t
+run(const char *name, const dwarf::dwarf &dw, int passes, Visit visit)
+{
+        size_t attrs = 0, allocs_before = allocations;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < passes; i++)
+                for (auto &cu : dw.compilation_units())
+                        for (auto &d : cu.dfs())
+                                attrs += visit(d);
+        auto end = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(end - start).count();
+        size_t allocs = (allocations - allocs_before) / passes;
+        printf("%-8s %zu attributes, %.1f ms, %zu allocations per pass\n",
+               name, attrs / passes, ms / passes, allocs);
+        return allocs;
+}
+
+int
+main(int argc, char **argv)
+{
+        if (argc < 2 || argc > 3) {
+                fprintf(stderr, "usage: %s elf-file [passes]\n", argv[0]);
+                return 2;
+        }
+        int passes = argc == 3 ? atoi(argv[2]) : 5;
+        if (passes <= 0)
+                passes = 1;
+
+        int fd = open(argv[1], O_RDONLY);
+        if (fd < 0) {
+                fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+                return 1;
+        }
+
+        elf::elf ef(elf::create_mmap_loader(fd));
+        dwarf::dwarf dw(dwarf::elf::create_loader(ef));
+        dw.advise(dwarf::section_type::info, dwarf::access_pattern::sequential);
+
+        // Warm up, so the first measurement doesn't pay for page
+        // faults and abbrev tables
+        run("warmup", dw, 1, [](const dwarf::die &d) {
+                size_t n = 0;
+                for (auto &attr : d.attributes())
+                        n += attr.second.get_type() != dwarf::value::type::invalid;
+                return n;
+        });
+
+        size_t walk_allocs = run("walk", dw, passes, [](const dwarf::die &d) {
+                return 0;
+        });
+
+        size_t range_allocs = run("range", dw, passes, [](const dwarf::die &d) {
+                size_t n = 0;
+                for (auto &attr : d.attributes())
+                        n += attr.second.get_type() != dwarf::value::type::invalid;
+                return n;
+        });
+
+        run("vector", dw, passes, [](const dwarf::die &d) {
+                vector<pair<dwarf::DW_AT, dwarf::value> > attrs(
+                        d.attributes().begin(), d.attributes().end());
+                size_t n = 0;
+                for (auto &attr : attrs)
+                        n += attr.second.get_type() != dwarf::value::type::invalid;
+                return n;
+        });
+
+        if (range_allocs != walk_allocs) {
+                printf("FAIL attr-bench: iterating over attributes allocated\n");
+                return 1;
+        }
+        return 0;
+}
@@ -0,0 +1,1038 @@
+// Test libdwarf++ on inputs that a golden dump does not cover.
+
+#include "elf++.hh"
+#include "dwarf++.hh"
+
+#include <fcntl.h>
+#include <functional>
+#include <map>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+static int failures;
+
+#define CHECK(cond)                                                     \
+        do {                                                            \
+                if (!(cond)) {                                          \
+                        printf("%s:%d: check failed: %s\n",             \
+                               __FILE__, __LINE__, #cond);              \
+                        failures++;                                     \
+                }                                                       \
+        } while (0)
+
+static elf::elf
+open_elf(const char *path)
+{
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+                perror(path);
+                exit(1);
+        }
+        return elf::elf(elf::create_mmap_loader(fd));
+}
+
+// DWARF 4 type units in a package are found through .debug_tu_index,
+// with their own abbrev and string offset contributions
+static void
+test_dwp_type_units()
+{
+        elf::elf ef = open_elf("inputs/dwp4-types");
+        dwarf::dwarf dw(dwarf::elf::create_loader(ef));
+        dw.set_package_path("inputs/dwp4-types.dwp");
+
+        set<string> names;
+        for (auto &cu : dw.compilation_units()) {
+                CHECK(cu.is_skeleton());
+                auto &split = cu.get_split_unit();
+                for (auto &d : split.dfs()) {
+                        for (auto &attr : d.attributes()) {
+                                if (attr.second.get_form() !=
+                                    dwarf::DW_FORM::ref_sig8)
+                                        continue;
+                                dwarf::die t = attr.second.as_reference();
+                                CHECK(t.tag == dwarf::DW_TAG::structure_type ||
+                                      t.tag == dwarf::DW_TAG::union_type ||
+                                      t.tag == dwarf::DW_TAG::enumeration_type);
+                                names.insert(at_name(t));
+                        }
+                }
+        }
+        CHECK(names.count("alpha") && names.count("beta") &&
+              names.count("gamma"));
+        for (auto &name : names)
+                CHECK(name == "alpha" || name == "beta" || name == "gamma" ||
+                      name == "delta");
+}
+
+// This binary has no asynchronous unwind tables, so the rules for
+// fib and main are only in .debug_frame
+static void
+test_unwind_table()
+{
+        elf::elf ef = open_elf("inputs/cfi-debug-frame");
+        dwarf::unwind_table t = dwarf::elf::create_unwind_table(ef);
+        // Three PLT rows, _start, fib, and main, each followed by a
+        // gap
+        CHECK(t.size() == 15);
+
+        // Outside any FDE
+        CHECK(!t.find(0));
+        CHECK(!t.find(0x1000));
+        CHECK(!t.find(0x1062));
+        CHECK(!t.find(0x1128));
+        CHECK(!t.find(0x117f));
+        CHECK(!t.find(0x10000));
+
+        // Inside fib: on entry, after push %rbp, and after mov
+        // %rsp,%rbp.  x86-64 numbers %rbp 6 and %rsp 7.
+        const dwarf::unwind_row *r = t.find(0x1129);
+        CHECK(r && r->pc == 0x1129);
+        CHECK(r && r->cfa.type == dwarf::unwind_rule_type::reg &&
+              r->cfa.reg == 7 && r->cfa.offset == 8);
+        CHECK(r && r->ra.type == dwarf::unwind_rule_type::offset &&
+              r->ra.offset == -8);
+        CHECK(r && r->fp.type == dwarf::unwind_rule_type::same_value);
+        r = t.find(0x112b);
+        CHECK(r && r->pc == 0x112a && r->cfa.reg == 7 &&
+              r->cfa.offset == 16);
+        CHECK(r && r->fp.type == dwarf::unwind_rule_type::offset &&
+              r->fp.offset == -16);
+        r = t.find(0x1150);
+        CHECK(r && r->pc == 0x112d && r->cfa.reg == 6 &&
+              r->cfa.offset == 16);
+        // The last instruction of fib, then the first of main
+        r = t.find(0x1163);
+        CHECK(r && r->cfa.reg == 7 && r->cfa.offset == 8);
+        r = t.find(0x1164);
+        CHECK(r && r->pc == 0x1164 &&
+              r->fp.type == dwarf::unwind_rule_type::same_value);
+
+        // The same table over borrowed rows
+        dwarf::unwind_table borrowed(t.rows(), t.size());
+        CHECK(borrowed.find(0x1150) == t.find(0x1150));
+
+        // .zdebug_frame gives the same rows
+        elf::elf zef = open_elf("inputs/cfi-zdebug-frame");
+        CHECK(!zef.get_section(".debug_frame").valid());
+        CHECK(zef.get_section(".zdebug_frame").valid());
+        dwarf::unwind_table zt = dwarf::elf::create_unwind_table(zef);
+        CHECK(zt.size() == t.size());
+        CHECK(zt.size() == t.size() &&
+              memcmp(zt.rows(), t.rows(), t.size() * sizeof(*t.rows())) == 0);
+}
+
+class test_expr_context : public dwarf::expr_context
+{
+public:
+        dwarf::taddr reg(unsigned regnum) override
+        {
+                return 0x1000 + regnum * 0x10;
+        }
+
+        dwarf::taddr frame_base() override
+        {
+                return 0x7000;
+        }
+};
+
+// Build a DWARF 4 unit in memory with one variable DIE for each
+// (name, location expression) and return the location expressions
+// by name
+static map<string, dwarf::expr>
+make_exprs(const vector<pair<string, vector<unsigned char> > > &progs,
+           dwarf::dwarf *dw, vector<unsigned char> *info)
+{
+        // 1: DW_TAG_compile_unit with children.  2: DW_TAG_variable
+        // with DW_AT_name as DW_FORM_string and DW_AT_location as
+        // DW_FORM_exprloc.
+        static const unsigned char abbrev[] = {
+                1, 0x11, 1, 0, 0,
+                2, 0x34, 0, 0x03, 0x08, 0x02, 0x18, 0, 0,
+                0,
+        };
+        *info = {0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 8, 1};
+        for (auto &prog : progs) {
+                info->push_back(2);
+                info->insert(info->end(), prog.first.begin(), prog.first.end());
+                info->push_back(0);
+                info->push_back(prog.second.size());
+                info->insert(info->end(), prog.second.begin(), prog.second.end());
+        }
+        info->push_back(0);
+        uint32_t len = info->size() - 4;
+        memcpy(info->data(), &len, 4);
+
+        *dw = dwarf::dwarf(dwarf::create_memory_loader({
+                {dwarf::section_type::abbrev, {abbrev, sizeof(abbrev)}},
+                {dwarf::section_type::info, {info->data(), info->size()}},
+        }));
+        map<string, dwarf::expr> exprs;
+        for (auto &d : dw->compilation_units().front().root())
+                exprs.emplace(at_name(d), d[dwarf::DW_AT::location].as_exprloc());
+        return exprs;
+}
+
+// expr_program evaluates the common single-operation expressions
+// without the interpreter, and resolves branch targets to operation
+// indexes when it decodes an expression
+static void
+test_expr_program()
+{
+        // DW_OP_* encodings
+        enum : unsigned char {
+                addr = 0x03, const1s = 0x09, const8u = 0x0e, constu = 0x10,
+                pick = 0x15, div = 0x1b, minus = 0x1c, plus_uconst = 0x23,
+                skip = 0x2f, bra = 0x28, lit0 = 0x30, lit1 = 0x31,
+                lit2 = 0x32, lit3 = 0x33, lit5 = 0x35, lit7 = 0x37,
+                lit10 = 0x3a, lit20 = 0x44, reg3 = 0x53, breg6 = 0x76,
+                regx = 0x90, fbreg = 0x91, bregx = 0x92, dup = 0x12,
+                nop = 0x96,
+        };
+        // Each of these has a fast path.  The same program followed
+        // by DW_OP_nop goes through the interpreter.
+        vector<pair<string, vector<unsigned char> > > fast = {
+                {"lit5", {lit5}},
+                {"const1s", {const1s, 0xfd}},
+                {"const8u", {const8u, 8, 7, 6, 5, 4, 3, 2, 1}},
+                {"addr", {addr, 0x00, 0x10, 0x40, 0, 0, 0, 0, 0}},
+                {"constu", {constu, 0xac, 0x02}},
+                {"breg6", {breg6, 0x70}},
+                {"bregx", {bregx, 17, 8}},
+                {"fbreg", {fbreg, 0x68}},
+                {"reg3", {reg3}},
+                {"regx", {regx, 40}},
+                {"plus_uconst", {plus_uconst, 16}},
+        };
+        auto progs = fast;
+        for (auto &prog : fast) {
+                progs.push_back(prog);
+                progs.back().first += "+nop";
+                progs.back().second.push_back(nop);
+        }
+        vector<pair<string, vector<unsigned char> > > general = {
+                // -7 / 2, which is the second entry divided by the top
+                {"div", {const1s, 0xf9, lit2, div}},
+                {"div0", {lit1, lit0, div}},
+                {"pick", {lit1, lit2, lit3, pick, 2}},
+                {"pick-underflow", {lit1, lit2, lit3, pick, 3}},
+                // arg ? 10 : 20, with a skip to the end
+                {"bra", {bra, 4, 0, lit20, skip, 1, 0, lit10}},
+                // Count arg down to 0
+                {"loop", {lit1, minus, dup, bra, 0xfa, 0xff}},
+                {"past-end", {lit7, skip, 100, 0, lit1}},
+                // Into the operand of the bra, and before the start
+                {"bad-target", {lit7, lit1, bra, 0xfe, 0xff}},
+                {"bad-target-untaken", {lit7, lit0, bra, 0xfe, 0xff}},
+                {"negative-target", {lit7, skip, 0x9c, 0xff}},
+        };
+        progs.insert(progs.end(), general.begin(), general.end());
+
+        dwarf::dwarf dw;
+        vector<unsigned char> info;
+        auto exprs = make_exprs(progs, &dw, &info);
+        CHECK(exprs.size() == progs.size());
+        test_expr_context ctx;
+
+        using type = dwarf::expr_result::type;
+        auto eval = [&](const string &name, initializer_list<dwarf::taddr> args) {
+                return exprs.at(name).evaluate(&ctx, args);
+        };
+        auto throws = [&](const string &name, initializer_list<dwarf::taddr> args) {
+                try {
+                        eval(name, args);
+                } catch (dwarf::expr_error &e) {
+                        return true;
+                }
+                return false;
+        };
+
+        // The fast paths against the interpreter
+        for (auto &prog : fast) {
+                auto a = eval(prog.first, {0x2000});
+                auto b = eval(prog.first + "+nop", {0x2000});
+                CHECK(a.location_type == b.location_type);
+                CHECK(a.value == b.value);
+        }
+        CHECK(eval("lit5", {}).value == 5);
+        CHECK(eval("const1s", {}).value == (dwarf::taddr)-3);
+        CHECK(eval("const8u", {}).value == 0x0102030405060708);
+        CHECK(eval("addr", {}).value == 0x401000);
+        CHECK(eval("constu", {}).value == 300);
+        CHECK(eval("breg6", {}).value == 0x1060 - 16);
+        CHECK(eval("bregx", {}).value == 0x1000 + 17 * 0x10 + 8);
+        CHECK(eval("fbreg", {}).value == 0x7000 - 24);
+        CHECK(eval("reg3", {}).location_type == type::reg);
+        CHECK(eval("reg3", {}).value == 3);
+        CHECK(eval("regx", {}).value == 40);
+        CHECK(eval("plus_uconst", {0x2000}).value == 0x2010);
+        CHECK(throws("plus_uconst", {}));
+        CHECK(throws("plus_uconst+nop", {}));
+
+        CHECK(eval("div", {}).value == (dwarf::taddr)-3);
+        CHECK(throws("div0", {}));
+        CHECK(eval("pick", {}).value == 1);
+        CHECK(throws("pick-underflow", {}));
+        CHECK(eval("bra", {1}).value == 10);
+        CHECK(eval("bra", {0}).value == 20);
+        CHECK(eval("loop", {5}).value == 0);
+        CHECK(eval("past-end", {}).value == 7);
+        CHECK(throws("bad-target", {}));
+        CHECK(eval("bad-target-untaken", {}).value == 7);
+        CHECK(throws("negative-target", {}));
+}
+
+// Records the file offsets it loads, the loads not yet released, and
+// the access hints it is given
+class recording_loader : public elf::loader
+{
+public:
+        explicit recording_loader(shared_ptr<elf::loader> l) : l(l) { }
+
+        const void *load(off_t offset, size_t size) override
+        {
+                loaded.insert(offset);
+                const void *data = l->load(offset, size);
+                live[data]++;
+                return data;
+        }
+
+        void release(const void *data, size_t size) override
+        {
+                if (--live[data] == 0)
+                        live.erase(data);
+                l->release(data, size);
+        }
+
+        void advise(off_t offset, size_t size,
+                    elf::access_pattern pattern) override
+        {
+                advised.emplace_back(offset, size, pattern);
+                l->advise(offset, size, pattern);
+        }
+
+        shared_ptr<elf::loader> l;
+        set<off_t> loaded;
+        map<const void*, int> live;
+        vector<tuple<off_t, size_t, elf::access_pattern> > advised;
+};
+
+// inputs/tiny-core is the core of a process that stopped at a hlt
+// with known register values.  Only its ELF header page was dumped.
+static void
+test_core_context()
+{
+        int fd = open("inputs/tiny-core", O_RDONLY);
+        if (fd < 0) {
+                perror("inputs/tiny-core");
+                exit(1);
+        }
+        auto l = make_shared<recording_loader>(elf::create_mmap_loader(fd));
+        elf::elf ef(l);
+        dwarf::core_context ctx = dwarf::elf::create_core_context(ef);
+
+        // Segments are loaded when they are first read.  The ELF
+        // header page is at file offset 0x4000.
+        CHECK(!l->loaded.count(0x4000));
+
+        CHECK(ctx.thread_count() == 1);
+        // %rbx, %rbp, %r12, and the return address column (%rip)
+        CHECK(ctx.reg(3) == 0x1122334455667788);
+        CHECK(ctx.reg(6) == 0);
+        CHECK(ctx.reg(12) == 0x0123456789abcdef);
+        CHECK(ctx.reg(16) == 0x40101b);
+        bool threw = false;
+        try {
+                ctx.reg(100);
+        } catch (dwarf::expr_error &e) {
+                threw = true;
+        }
+        CHECK(threw);
+
+        char buf[32];
+        CHECK(ctx.read(0x400000, buf, 4) && memcmp(buf, "\x7f" "ELF", 4) == 0);
+        CHECK(l->loaded.count(0x4000));
+        CHECK(ctx.deref_size(0x400000, 4) == 0x464c457f);
+        const char *p = (const char*)ctx.data_at(0x400000, 4);
+        CHECK(p && memcmp(p, "\x7f" "ELF", 4) == 0);
+
+        // The text page was not dumped, so it reads as zeros but has
+        // no file data
+        CHECK(!ctx.data_at(0x401000, 1));
+        memset(buf, 0xff, sizeof(buf));
+        CHECK(ctx.read(0x400ff0, buf, sizeof(buf)));
+        CHECK(buf[31] == 0 && buf[16] == 0);
+        CHECK(!ctx.data_at(0x400ff0, sizeof(buf)));
+
+        // Nothing is mapped at 0x1000 or past the end of the last
+        // page of the executable
+        CHECK(!ctx.read(0x1000, buf, 1));
+        CHECK(!ctx.read(0x402ff0, buf, sizeof(buf)));
+}
+
+// die::resolve without the unit's origin cache: follow the abstract
+// origin, then its specification, or else the specification
+static dwarf::value
+resolve_uncached(const dwarf::die &d, dwarf::DW_AT attr)
+{
+        if (d.has(attr))
+                return d[attr];
+        if (d.has(dwarf::DW_AT::abstract_origin)) {
+                dwarf::die ao = d[dwarf::DW_AT::abstract_origin].as_reference();
+                if (ao.has(attr))
+                        return ao[attr];
+                if (ao.has(dwarf::DW_AT::specification)) {
+                        dwarf::die s = ao[dwarf::DW_AT::specification].as_reference();
+                        if (s.has(attr))
+                                return s[attr];
+                }
+        } else if (d.has(dwarf::DW_AT::specification)) {
+                dwarf::die s = d[dwarf::DW_AT::specification].as_reference();
+                if (s.has(attr))
+                        return s[attr];
+        }
+        return dwarf::value();
+}
+
+// Return the unit of the DIE that d's attributes are resolved from
+static const dwarf::unit &
+origin_unit(const dwarf::die &d)
+{
+        auto attr = d.has(dwarf::DW_AT::abstract_origin) ?
+                dwarf::DW_AT::abstract_origin : dwarf::DW_AT::specification;
+        return d[attr].as_reference().get_unit();
+}
+
+// Check that d.resolve(attr) matches resolve_uncached
+static void
+check_resolve(const dwarf::die &d, dwarf::DW_AT attr)
+{
+        try {
+                dwarf::value got = d.resolve(attr);
+                dwarf::value want = resolve_uncached(d, attr);
+                CHECK(got.valid() == want.valid());
+                if (!got.valid() || !want.valid())
+                        return;
+                CHECK(got.get_form() == want.get_form());
+                CHECK(to_string(got) == to_string(want));
+                CHECK(got.get_section_offset() == want.get_section_offset());
+                if (got.get_type() != dwarf::value::type::reference)
+                        return;
+                dwarf::die gd = got.as_reference(), wd = want.as_reference();
+                CHECK(gd.get_section_offset() == wd.get_section_offset());
+                CHECK(gd.tag == wd.tag);
+        } catch (dwarf::format_error &e) {
+                // Such as a value read from the wrong unit
+                printf("<%lx> %s: %s\n", (unsigned long)d.get_section_offset(),
+                       to_string(attr).c_str(), e.what());
+                failures++;
+        }
+}
+
+// Check resolve against resolve_uncached for every DIE of dw, and
+// return the number of resolved values that came from another unit
+static int
+check_resolve(const dwarf::dwarf &dw)
+{
+        static const dwarf::DW_AT attrs[] = {
+                dwarf::DW_AT::name, dwarf::DW_AT::type,
+                dwarf::DW_AT::decl_line, dwarf::DW_AT::external,
+                dwarf::DW_AT::inline_, dwarf::DW_AT::low_pc,
+        };
+        int cross = 0;
+        for (auto &cu : dw.compilation_units()) {
+                for (auto &d : cu.dfs()) {
+                        for (auto attr : attrs) {
+                                // Twice, so the second is served from
+                                // the cache
+                                check_resolve(d, attr);
+                                check_resolve(d, attr);
+                                if (!d.has(attr) && d.resolve(attr).valid() &&
+                                    origin_unit(d) != cu)
+                                        cross++;
+                        }
+                }
+        }
+        return cross;
+}
+
+// Abstract origins and specifications that cross units, as LTO and
+// tools like dwz emit
+static void
+test_resolve_cache()
+{
+        // LTO refers from the output unit to the early debug info of
+        // each source file with DW_FORM_ref_addr
+        elf::elf ef = open_elf("inputs/origin");
+        dwarf::dwarf lto(dwarf::elf::create_loader(ef));
+        CHECK(check_resolve(lto) > 0);
+        bool bump = false;
+        for (auto &d : lto.compilation_units().front().dfs()) {
+                // The inlined call of bump has its abstract origin in
+                // another unit, and its name is on the origin's
+                // specification in that unit
+                if (d.tag == dwarf::DW_TAG::inlined_subroutine &&
+                    d.has(dwarf::DW_AT::abstract_origin) &&
+                    d.resolve(dwarf::DW_AT::name).as_string() == "bump") {
+                        dwarf::die ao = d[dwarf::DW_AT::abstract_origin].as_reference();
+                        CHECK(ao.get_unit() != lto.compilation_units().front());
+                        CHECK(ao.has(dwarf::DW_AT::specification));
+                        bump = true;
+                }
+        }
+        CHECK(bump);
+
+        // GCC keeps each specification in the unit of its DIE, so
+        // build units by hand in which it does not: a declaration
+        // in unit A, an abstract instance in unit B that completes
+        // it, and concrete instances in unit C
+        vector<unsigned char> info;
+        auto u8 = [&](unsigned v) { info.push_back(v); };
+        auto u32 = [&](uint32_t v) {
+                for (int i = 0; i < 4; i++)
+                        u8(v >> (8 * i));
+        };
+        auto u64 = [&](uint64_t v) {
+                for (int i = 0; i < 8; i++)
+                        u8(v >> (8 * i));
+        };
+        auto str = [&](const char *v) {
+                info.insert(info.end(), v, v + strlen(v) + 1);
+        };
+        // A DWARF 4 unit header and its DW_TAG_compile_unit
+        auto begin_unit = [&]() {
+                size_t start = info.size();
+                u32(0);
+                u8(4); u8(0);
+                u32(0);
+                u8(8);
+                u8(1);
+                return start;
+        };
+        auto end_unit = [&](size_t start) {
+                u8(0);
+                uint32_t len = info.size() - start - 4;
+                memcpy(&info[start], &len, 4);
+        };
+
+        size_t a = begin_unit();
+        uint32_t int_type = info.size() - a;
+        u8(2); str("int"); u8(4);
+        uint32_t decl = info.size();
+        u8(3); str("decl"); u32(int_type); u8(7);
+        end_unit(a);
+
+        size_t b = begin_unit();
+        uint32_t abstract = info.size();
+        u8(4); u32(decl); u8(1);
+        end_unit(b);
+
+        size_t c = begin_unit();
+        // Through B's abstract instance to A's declaration
+        u8(5); u32(abstract); u64(0x1000);
+        // Straight to A's declaration
+        u8(6); u32(decl); u64(0x2000);
+        // Through an abstract instance in this unit to A
+        u8(7); u32(info.size() + 12 - c); u64(0x3000);
+        u8(4); u32(decl); u8(1);
+        end_unit(c);
+
+        // 1: DW_TAG_compile_unit with children.  2: DW_TAG_base_type.
+        // 3: a declaring DW_TAG_subprogram.  4-7: DW_TAG_subprograms
+        // with a specification or abstract origin.
+        static const unsigned char abbrev[] = {
+                1, 0x11, 1, 0, 0,
+                2, 0x24, 0, 0x03, 0x08, 0x0b, 0x0b, 0, 0,
+                3, 0x2e, 0, 0x03, 0x08, 0x49, 0x13, 0x3b, 0x0b,
+                0x3c, 0x19, 0, 0,
+                4, 0x2e, 0, 0x47, 0x10, 0x20, 0x0b, 0, 0,
+                5, 0x2e, 0, 0x31, 0x10, 0x11, 0x01, 0, 0,
+                6, 0x2e, 0, 0x47, 0x10, 0x11, 0x01, 0, 0,
+                7, 0x2e, 0, 0x31, 0x13, 0x11, 0x01, 0, 0,
+                0,
+        };
+        dwarf::dwarf dw(dwarf::create_memory_loader({
+                {dwarf::section_type::abbrev, {abbrev, sizeof(abbrev)}},
+                {dwarf::section_type::info, {info.data(), info.size()}},
+        }));
+        CHECK(check_resolve(dw) > 0);
+
+        auto &units = dw.compilation_units();
+        CHECK(units.size() == 3);
+        int concrete = 0;
+        for (auto &d : units.at(2).root()) {
+                if (!d.has(dwarf::DW_AT::low_pc))
+                        continue;
+                concrete++;
+                CHECK(d.resolve(dwarf::DW_AT::name).as_string() == "decl");
+                CHECK(d.resolve(dwarf::DW_AT::decl_line).as_uconstant() == 7);
+                // The type reference is relative to unit A
+                dwarf::die t = d.resolve(dwarf::DW_AT::type).as_reference();
+                CHECK(t.get_unit() == units.at(0));
+                CHECK(t.tag == dwarf::DW_TAG::base_type && at_name(t) == "int");
+                bool inherits_inline = d.has(dwarf::DW_AT::abstract_origin);
+                CHECK(d.resolve(dwarf::DW_AT::inline_).valid() == inherits_inline);
+        }
+        CHECK(concrete == 3);
+}
+
+// The string_view accessors agree with the std::string accessors,
+// and get_description fills a buffer like snprintf
+static void
+test_string_views()
+{
+        for (const char *path : {"golden-gcc-4.9.2/example",
+                                 "golden-gcc-6.2.1-s390x/example",
+                                 "golden-gcc-12.2.0/example"}) {
+                elf::elf ef = open_elf(path);
+                dwarf::dwarf dw(dwarf::elf::create_loader(ef));
+                int strings = 0, rows = 0;
+                for (auto &cu : dw.compilation_units()) {
+                        const dwarf::die &root = cu.root();
+                        CHECK(cu.name_view() == cu.name());
+                        CHECK(root.has(dwarf::DW_AT::comp_dir) &&
+                              cu.comp_dir_view() == at_comp_dir(root));
+
+                        for (auto &d : cu.dfs()) {
+                                for (auto &attr : d.attributes()) {
+                                        auto &val = attr.second;
+                                        if (val.get_type() != dwarf::value::type::string)
+                                                continue;
+                                        auto view = val.as_string_view();
+                                        CHECK(view == val.as_string());
+                                        CHECK(view.data() == val.as_cstr());
+                                        strings++;
+                                }
+                                if (d.has(dwarf::DW_AT::name))
+                                        CHECK(at_name_view(d) == at_name(d));
+                                if (d.has(dwarf::DW_AT::producer))
+                                        CHECK(at_producer_view(d) == at_producer(d));
+                                if (d.has(dwarf::DW_AT::linkage_name))
+                                        CHECK(at_linkage_name_view(d) ==
+                                              at_linkage_name(d));
+                        }
+
+                        for (auto &row : cu.get_line_table()) {
+                                string want = row.get_description();
+                                char buf[256];
+                                CHECK(row.get_description(buf, sizeof(buf)) ==
+                                      want.size());
+                                CHECK(want == buf);
+
+                                // Cut short, with the terminator in
+                                // the last byte and the bytes after
+                                // it untouched
+                                size_t size = want.size() / 2 + 1;
+                                memset(buf, 'x', sizeof(buf));
+                                CHECK(row.get_description(buf, size) ==
+                                      want.size());
+                                CHECK(buf[size - 1] == 0 && buf[size] == 'x');
+                                CHECK(want.compare(0, size - 1, buf) == 0);
+
+                                CHECK(row.get_description(nullptr, 0) ==
+                                      want.size());
+                                rows++;
+                        }
+                }
+                CHECK(strings > 0);
+                CHECK(rows > 0);
+        }
+}
+
+// A DWARF loader over a pread loader releases the buffers it loaded,
+// one section at a time or all at once when the dwarf object goes
+// away
+static void
+test_elf_loader_release()
+{
+        const char *path = "golden-gcc-4.9.2/example";
+        elf::elf mapped = open_elf(path);
+        auto rl = make_shared<recording_loader>(
+                elf::create_pread_loader(open(path, O_RDONLY)));
+        elf::elf ef(rl);
+        // Load the section name table, which the file keeps
+        CHECK(ef.get_section(".debug_info").valid());
+        size_t kept = rl->live.size();
+
+        auto dl = dwarf::elf::create_loader(ef);
+        size_t size;
+        const void *info = dl->load(dwarf::section_type::info, &size);
+        auto &want = mapped.get_section(".debug_info");
+        CHECK(size == want.size() && memcmp(info, want.data(), size) == 0);
+        // A second load is served from the DWARF loader
+        CHECK(dl->load(dwarf::section_type::info, &size) == info);
+        CHECK(rl->live.count(info) && rl->live.size() == kept + 1);
+        dl->release(dwarf::section_type::info);
+        CHECK(!rl->live.count(info) && rl->live.size() == kept);
+        // Releasing a section that is not loaded does nothing
+        dl->release(dwarf::section_type::info);
+        dl->release(dwarf::section_type::ranges);
+        CHECK(rl->live.size() == kept);
+
+        {
+                dwarf::dwarf dw(dl);
+                for (auto &cu : dw.compilation_units()) {
+                        for (auto &d : cu.dfs())
+                                (void)d;
+                        (void)cu.get_line_table().begin();
+                }
+                CHECK(rl->live.size() > kept);
+        }
+        CHECK(rl->live.size() == kept);
+}
+
+// A compressed section that prefetch is decompressing in the
+// background, loaded right away
+static void
+test_prefetch_compressed()
+{
+        elf::elf plain = open_elf("inputs/gz");
+        auto &want = plain.get_section(".debug_info");
+        for (int i = 0; i < 20; i++) {
+                elf::elf ef(elf::create_async_loader(
+                                    open("inputs/gz-zlib", O_RDONLY), 2));
+                CHECK(ef.get_section(".debug_info").is_compressed());
+                auto dl = dwarf::elf::create_loader(ef);
+                dl->prefetch(dwarf::section_type::info);
+                dl->prefetch(dwarf::section_type::abbrev);
+                dl->prefetch(dwarf::section_type::str);
+                size_t size;
+                const void *info = dl->load(dwarf::section_type::info, &size);
+                CHECK(size == want.size() &&
+                      memcmp(info, want.data(), size) == 0);
+                // Every third loader is destroyed while its
+                // decompressions may still be running
+                if (i % 3 == 0)
+                        continue;
+                dwarf::dwarf dw(dl);
+                CHECK(!dw.compilation_units().empty());
+        }
+}
+
+// The library advises sequential access for exactly the sections it
+// reads whole, and leaves everything else to the caller
+static void
+test_advise()
+{
+        using elf::access_pattern;
+        typedef tuple<off_t, size_t, access_pattern> hint;
+        auto sequential = [](const elf::section &sec) {
+                return hint(sec.get_hdr().offset, sec.get_hdr().size,
+                            access_pattern::sequential);
+        };
+
+        int fd = open("inputs/cfi-debug-frame", O_RDONLY);
+        if (fd < 0) {
+                perror("inputs/cfi-debug-frame");
+                exit(1);
+        }
+        auto l = make_shared<recording_loader>(elf::create_mmap_loader(fd));
+        elf::elf ef(l);
+
+        // The constructor reads every unit header
+        dwarf::dwarf dw(dwarf::elf::create_loader(ef));
+        CHECK(l->advised == vector<hint>{
+                        sequential(ef.get_section(".debug_info"))});
+
+        // Walking a unit and building its line table don't advise
+        l->advised.clear();
+        for (auto &cu : dw.compilation_units()) {
+                for (auto &d : cu.dfs())
+                        (void)d;
+                for (auto &row : cu.get_line_table())
+                        (void)row;
+        }
+        CHECK(l->advised.empty());
+
+        // Hints from the caller go to the section's range
+        dw.advise(dwarf::section_type::line, dwarf::access_pattern::random);
+        auto &line = ef.get_section(".debug_line");
+        CHECK(l->advised == vector<hint>{
+                        hint(line.get_hdr().offset, line.get_hdr().size,
+                             access_pattern::random)});
+
+        l->advised.clear();
+        dwarf::elf::create_unwind_table(ef);
+        CHECK((l->advised == vector<hint>{
+                        sequential(ef.get_section(".eh_frame")),
+                        sequential(ef.get_section(".debug_frame"))}));
+
+        // Every DWARF pattern converts to the libelf++ pattern of the
+        // same name
+        static const pair<dwarf::access_pattern, access_pattern> patterns[] = {
+                {dwarf::access_pattern::normal, access_pattern::normal},
+                {dwarf::access_pattern::sequential, access_pattern::sequential},
+                {dwarf::access_pattern::random, access_pattern::random},
+                {dwarf::access_pattern::willneed, access_pattern::willneed},
+        };
+        for (auto &p : patterns) {
+                access_pattern got = dwarf::elf::access_pattern_cast{p.first};
+                CHECK(got == p.second);
+        }
+}
+
+// An implicit_const value has no data of its own, so its offset is
+// its DIE's, and its constant comes from the abbrev
+static void
+test_implicit_const()
+{
+        elf::elf ef = open_elf("golden-gcc-12.2.0/example");
+        dwarf::dwarf dw(dwarf::elf::create_loader(ef));
+        int found = 0;
+        set<int64_t> constants;
+        for (auto &cu : dw.compilation_units()) {
+                for (auto &d : cu.dfs()) {
+                        for (auto &attr : d.attributes()) {
+                                auto &val = attr.second;
+                                if (val.get_form() != dwarf::DW_FORM::implicit_const)
+                                        continue;
+                                CHECK(val.get_section_offset() ==
+                                      d.get_section_offset());
+                                CHECK(val.get_unit_offset() ==
+                                      d.get_unit_offset());
+                                CHECK(d[attr.first].as_sconstant() ==
+                                      val.as_sconstant());
+                                constants.insert(val.as_sconstant());
+                                found++;
+                        }
+                }
+        }
+        // The abbrevs give decl_file 1, decl_line 8, and byte_size 8
+        CHECK(found > 0);
+        CHECK((constants == set<int64_t>{1, 8}));
+}
+
+// Return whether dw.die_at_offset(offset) throws out_of_range
+static bool
+no_die_at(const dwarf::dwarf &dw, dwarf::section_offset offset)
+{
+        try {
+                dw.die_at_offset(offset);
+        } catch (out_of_range &e) {
+                return true;
+        }
+        return false;
+}
+
+// Every DIE is found again by its offset, and offsets outside the
+// DIEs of compilation units are not
+static void
+test_die_at_offset()
+{
+        for (const char *path : {"golden-gcc-4.9.2/example",
+                                 "golden-gcc-6.2.1-s390x/example",
+                                 "golden-gcc-12.2.0/example",
+                                 "golden-gcc-12.2.0-types/example",
+                                 "inputs/origin"}) {
+                elf::elf ef = open_elf(path);
+                dwarf::dwarf dw(dwarf::elf::create_loader(ef));
+                int dies = 0;
+                for (auto &cu : dw.compilation_units()) {
+                        for (auto &d : cu.dfs()) {
+                                dwarf::die got = dw.die_at_offset(d.get_section_offset());
+                                CHECK(got == d);
+                                CHECK(got.tag == d.tag);
+                                CHECK(got.get_unit() == cu);
+                                dies++;
+                        }
+                        // Inside the unit header
+                        CHECK(no_die_at(dw, cu.get_section_offset()));
+                        CHECK(no_die_at(dw, cu.root().get_section_offset() - 1));
+                }
+                CHECK(dies > 0);
+                // Past the end
+                auto size = ef.get_section(".debug_info").size();
+                CHECK(no_die_at(dw, size));
+                CHECK(no_die_at(dw, size + 100));
+        }
+
+        // Here a DWARF 5 type unit comes before the only compilation
+        // unit
+        elf::elf ef = open_elf("golden-gcc-12.2.0-types/example");
+        dwarf::dwarf types(dwarf::elf::create_loader(ef));
+        CHECK(types.compilation_units().size() == 1);
+        auto first = types.compilation_units().front().get_section_offset();
+        CHECK(first > 0);
+        for (dwarf::section_offset off = 0; off < first; off++)
+                CHECK(no_die_at(types, off));
+
+        // A DWARF 5 type unit between two compilation units
+        vector<unsigned char> info;
+        auto u8 = [&](unsigned v) { info.push_back(v); };
+        auto u32 = [&](uint32_t v) {
+                for (int i = 0; i < 4; i++)
+                        u8(v >> (8 * i));
+        };
+        auto begin_unit = [&](unsigned type) {
+                size_t start = info.size();
+                u32(0);
+                u8(5); u8(0);
+                u8(type);
+                u8(8);
+                u32(0);
+                return start;
+        };
+        auto end_unit = [&](size_t start) {
+                uint32_t len = info.size() - start - 4;
+                memcpy(&info[start], &len, 4);
+        };
+        size_t a = begin_unit(1);
+        u8(1);
+        end_unit(a);
+        size_t t = begin_unit(2);
+        // The signature and the offset of the type
+        u32(0x12345678); u32(0x9abcdef0);
+        size_t type_offset = info.size();
+        u32(0);
+        u8(3);
+        uint32_t type = info.size() - t;
+        memcpy(&info[type_offset], &type, 4);
+        u8(2);
+        u8(0);
+        end_unit(t);
+        size_t b = begin_unit(1);
+        u8(1);
+        end_unit(b);
+
+        // 1: DW_TAG_compile_unit.  2: DW_TAG_structure_type.  3:
+        // DW_TAG_type_unit with children.
+        static const unsigned char abbrev[] = {
+                1, 0x11, 0, 0, 0,
+                2, 0x13, 0, 0, 0,
+                3, 0x41, 1, 0, 0,
+                0,
+        };
+        dwarf::dwarf dw(dwarf::create_memory_loader({
+                {dwarf::section_type::abbrev, {abbrev, sizeof(abbrev)}},
+                {dwarf::section_type::info, {info.data(), info.size()}},
+        }));
+        auto &units = dw.compilation_units();
+        CHECK(units.size() == 2);
+        CHECK(dw.die_at_offset(a + 12).tag == dwarf::DW_TAG::compile_unit);
+        CHECK(dw.die_at_offset(b + 12).tag == dwarf::DW_TAG::compile_unit);
+        CHECK(&dw.unit_at_offset(b + 12) == &units.at(1));
+        for (size_t off = t; off < b; off++)
+                CHECK(no_die_at(dw, off));
+        CHECK(no_die_at(dw, info.size()));
+}
+
+typedef vector<pair<dwarf::section_offset, unsigned> > dfs_order;
+
+// Append the offset and depth of d and each DIE under it to out in
+// pre-order, keeping those for which keep is true and not descending
+// below those for which prune is true
+template<typename Keep, typename Prune>
+static void
+walk(const dwarf::die &d, unsigned depth, Keep keep, Prune prune,
+     dfs_order *out)
+{
+        if (keep(d))
+                out->emplace_back(d.get_section_offset(), depth);
+        if (prune(d))
+                return;
+        for (auto &child : d)
+                walk(child, depth + 1, keep, prune, out);
+}
+
+// Return the offsets and depths of a unit::dfs range, skipping the
+// children of DIEs for which prune is true
+template<typename Prune>
+static dfs_order
+scan(const dwarf::unit::dfs_range &range, Prune prune)
+{
+        dfs_order out;
+        for (auto it = range.begin(); it != range.end(); ++it) {
+                out.emplace_back(it->get_section_offset(), it.depth());
+                if (prune(*it))
+                        it.skip_children();
+        }
+        return out;
+}
+
+// unit::dfs, with and without a tag and with subtrees skipped, visits
+// the DIEs that a recursive walk over children does
+static void
+test_dfs()
+{
+        auto all = [](const dwarf::die &) { return true; };
+        auto none = [](const dwarf::die &) { return false; };
+        auto subprogram = [](const dwarf::die &d) {
+                return d.tag == dwarf::DW_TAG::subprogram;
+        };
+        auto has_children = [](const dwarf::die &d) {
+                return d.begin() != d.end();
+        };
+        auto with_sibling = [&](const dwarf::die &d) {
+                return has_children(d) && d.has(dwarf::DW_AT::sibling);
+        };
+        auto without_sibling = [&](const dwarf::die &d) {
+                return has_children(d) && !d.has(dwarf::DW_AT::sibling);
+        };
+
+        vector<function<bool(const dwarf::die &)> > prunes = {
+                subprogram, with_sibling, without_sibling,
+        };
+
+        int siblings = 0, no_siblings = 0, subprograms = 0;
+        for (const char *path : {"golden-gcc-4.9.2/example",
+                                 "golden-gcc-6.2.1-s390x/example",
+                                 "golden-gcc-12.2.0/example",
+                                 "inputs/origin"}) {
+                elf::elf ef = open_elf(path);
+                dwarf::dwarf dw(dwarf::elf::create_loader(ef));
+                for (auto &cu : dw.compilation_units()) {
+                        const dwarf::die &root = cu.root();
+                        dfs_order want;
+                        walk(root, 0, all, none, &want);
+                        CHECK(scan(cu.dfs(), none) == want);
+
+                        want.clear();
+                        walk(root, 0, subprogram, none, &want);
+                        CHECK(scan(cu.dfs(dwarf::DW_TAG::subprogram), none) == want);
+                        subprograms += want.size();
+
+                        // Skipping subtrees, which jumps by
+                        // DW_AT_sibling or reads past the subtree
+                        for (auto &prune : prunes) {
+                                want.clear();
+                                walk(root, 0, all, prune, &want);
+                                CHECK(scan(cu.dfs(), prune) == want);
+                        }
+                        want.clear();
+                        walk(root, 0, subprogram, subprogram, &want);
+                        CHECK(scan(cu.dfs(dwarf::DW_TAG::subprogram),
+                                   subprogram) == want);
+
+                        for (auto &d : cu.dfs()) {
+                                siblings += with_sibling(d);
+                                no_siblings += without_sibling(d);
+                        }
+                }
+        }
+        CHECK(siblings > 0 && no_siblings > 0 && subprograms > 0);
+}
+
+int
+main()
+{
+        test_dwp_type_units();
+        test_unwind_table();
+        test_expr_program();
+        test_core_context();
+        test_resolve_cache();
+        test_string_views();
+        test_elf_loader_release();
+        test_prefetch_compressed();
+        test_advise();
+        test_implicit_const();
+        test_die_at_offset();
+        test_dfs();
+
+        printf("%s dwarf-test\n", failures ? "FAIL" : "PASS");
+        return failures ? 1 : 0;
+}
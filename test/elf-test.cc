@@ -0,0 +1,721 @@
+// Test libelf++ on inputs that a golden dump does not cover.
+
+#include "elf++.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <fcntl.h>
+#include <map>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+static int failures;
+
+#define CHECK(cond)                                                     \
+        do {                                                            \
+                if (!(cond)) {                                          \
+                        printf("%s:%d: check failed: %s\n",             \
+                               __FILE__, __LINE__, #cond);              \
+                        failures++;                                     \
+                }                                                       \
+        } while (0)
+
+static elf::elf
+open_elf(const char *path)
+{
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+                perror(path);
+                exit(1);
+        }
+        return elf::elf(elf::create_mmap_loader(fd));
+}
+
+// A file whose section headers were removed, like a core file or
+// the output of sstrip
+static void
+test_no_section_headers()
+{
+        elf::elf f = open_elf("inputs/no-shdrs");
+        CHECK(f.sections().empty());
+        CHECK(!f.get_section(".text").valid());
+        CHECK(!f.get_section(".note.gnu.build-id").valid());
+
+        // The build ID is still in a note segment
+        static const unsigned char want[] = {
+                0xb9, 0x6c, 0xd1, 0x4d, 0xfa, 0xc1, 0x63, 0xbb, 0x9c, 0xc9,
+                0x15, 0x35, 0xeb, 0x73, 0x62, 0x22, 0x33, 0x1a, 0x3b, 0x74,
+        };
+        size_t size = 0;
+        const void *id = f.get_build_id(&size);
+        CHECK(id && size == sizeof(want) && memcmp(id, want, size) == 0);
+
+        elf::debug_resolver resolver({"inputs/no-such-dir"});
+        CHECK(!resolver.resolve(f, "inputs/no-shdrs").valid());
+}
+
+// crc32_update has a separate implementation on ARM, which must
+// agree with zlib for every alignment and length
+static void
+test_crc32()
+{
+        std::vector<unsigned char> buf(4096 + 8);
+        unsigned seed = 1;
+        for (auto &b : buf) {
+                seed = seed * 1103515245 + 12345;
+                b = seed >> 16;
+        }
+        for (size_t off = 0; off < 8; off++) {
+                for (size_t len = 0; len <= 100; len++)
+                        CHECK(elf::crc32_update(0, &buf[off], len) ==
+                              crc32(0, &buf[off], len));
+                CHECK(elf::crc32_update(0, &buf[off], 4096) ==
+                      crc32(0, &buf[off], 4096));
+                // Continuing a CRC over an odd split
+                uint32_t crc = elf::crc32_update(0, &buf[off], 1001);
+                crc = elf::crc32_update(crc, &buf[off + 1001], 3095);
+                CHECK(crc == crc32(0, &buf[off], 4096));
+        }
+        CHECK(elf::crc32_update(0, "123456789", 9) == 0xcbf43926);
+}
+
+// A stripped file without a build ID whose debug file is found by its
+// .gnu_debuglink, and only if the CRC matches
+static void
+test_debuglink()
+{
+        elf::debug_resolver resolver({"inputs/no-such-dir"});
+
+        elf::elf f = open_elf("inputs/debuglink");
+        size_t id_size;
+        CHECK(!f.get_build_id(&id_size));
+        CHECK(!f.get_section(".symtab").valid());
+        elf::elf d = resolver.resolve(f, "inputs/debuglink");
+        CHECK(d.valid());
+        if (d.valid()) {
+                CHECK(d.get_section(".debug_info").valid());
+                auto &symtab = d.get_section(".symtab");
+                CHECK(symtab.valid() &&
+                      symtab.as_symtab().lookup("fib") !=
+                      symtab.as_symtab().end());
+        }
+
+        elf::elf bad = open_elf("inputs/debuglink-badcrc");
+        CHECK(!resolver.resolve(bad, "inputs/debuglink-badcrc").valid());
+}
+
+// A stripped file without a build ID whose symbols are only in its
+// MiniDebugInfo
+static void
+test_minidebuginfo()
+{
+        elf::elf f = open_elf("inputs/minidebuginfo");
+        try {
+                elf::open_gnu_debugdata(f);
+        } catch (elf::format_error &e) {
+                // Built without LZMA support
+                printf("SKIP elf-test MiniDebugInfo: %s\n", e.what());
+                return;
+        }
+
+        // The index must keep the decompressed image alive
+        elf::symbol_index index(f);
+        const elf::symbol_index::entry *e = index.find(0x1129 + 8);
+        CHECK(e && e->value == 0x1129);
+        size_t len;
+        CHECK(e && strcmp(index.get_name(*e, &len), "fib") == 0 && len == 3);
+}
+
+// A small .gnu_debugdata that expands far more than any symbol table
+static void
+test_debugdata_bomb()
+{
+        elf::elf f = open_elf("inputs/debugdata-bomb");
+        bool threw = false;
+        try {
+                elf::open_gnu_debugdata(f);
+        } catch (elf::format_error &e) {
+                threw = true;
+        }
+        CHECK(threw);
+        // The index leaves out what it can't decompress
+        elf::symbol_index index(f);
+        CHECK(!index.find(0x1129));
+}
+
+// The first lookups of a symbol table build its name index, and may
+// come from several threads at once
+static void
+test_symtab_lookup()
+{
+        elf::elf f = open_elf("golden-gcc-4.9.2/example");
+        for (auto &sec : f.sections()) {
+                if (sec.get_hdr().type != elf::sht::symtab &&
+                    sec.get_hdr().type != elf::sht::dynsym)
+                        continue;
+                auto tab = sec.as_symtab();
+                std::atomic<int> found{0}, missing{0};
+                std::vector<std::thread> threads;
+                for (int i = 0; i < 8; i++)
+                        threads.emplace_back([&] {
+                                if (tab.lookup("fib") != tab.end())
+                                        found++;
+                                if (tab.lookup("no such symbol") == tab.end())
+                                        missing++;
+                        });
+                for (auto &t : threads)
+                        t.join();
+                CHECK(missing == 8);
+                if (sec.get_hdr().type == elf::sht::symtab)
+                        CHECK(found == 8);
+        }
+}
+
+// Section and segment ranges are random-access, and their iterators
+// outlive the range
+static void
+test_lazy_range()
+{
+        elf::elf f = open_elf("golden-gcc-4.9.2/example");
+        auto begin = f.sections().begin(), end = f.sections().end();
+        CHECK((size_t)(end - begin) == f.sections().size());
+        CHECK(begin[3].get_name() == f.get_section(3).get_name());
+        CHECK(&*(begin + 3) == &f.get_section(3));
+        CHECK(&*(end - 1) == &f.sections().at(f.sections().size() - 1));
+        CHECK(begin < end && !(end <= begin));
+
+        auto text = std::find_if(begin, end, [](const elf::section &sec) {
+                return sec.get_name() == ".text";
+        });
+        CHECK(text != end && &*text == &f.get_section(".text"));
+
+        auto segs = f.segments();
+        CHECK(std::distance(segs.begin(), segs.end()) ==
+              (std::ptrdiff_t)segs.size());
+}
+
+// Compressed debug sections decompress to the sections of the
+// uncompressed file they were made from
+static void
+test_compressed_sections()
+{
+        elf::elf plain = open_elf("inputs/gz");
+        for (const char *path : {"inputs/gz-zlib", "inputs/gz-zstd",
+                                 "inputs/gz-zdebug"}) {
+                elf::elf f = open_elf(path);
+                int compressed = 0;
+                try {
+                        for (auto &sec : f.sections()) {
+                                std::string name = sec.get_name();
+                                if (name.starts_with(".zdebug"))
+                                        name = "." + name.substr(2);
+                                auto &want = plain.get_section(name);
+                                CHECK(want.valid());
+                                if (!sec.is_compressed()) {
+                                        CHECK(sec.uncompressed_data() == sec.data());
+                                        CHECK(sec.uncompressed_size() == sec.size());
+                                        continue;
+                                }
+                                compressed++;
+                                CHECK(sec.uncompressed_size() == want.size());
+                                CHECK(sec.uncompressed_size() == want.size() &&
+                                      memcmp(sec.uncompressed_data(), want.data(),
+                                             want.size()) == 0);
+                        }
+                } catch (elf::format_error &e) {
+                        if (strcmp(path, "inputs/gz-zstd") == 0 &&
+                            strstr(e.what(), "unsupported")) {
+                                // Built without zstd support
+                                printf("SKIP elf-test zstd: %s\n", e.what());
+                                continue;
+                        }
+                        printf("%s: %s\n", path, e.what());
+                        CHECK(!"decompression failed");
+                }
+                CHECK(compressed >= 2);
+        }
+}
+
+// Return the result of decompressing section name of the file at
+// path after patch has modified the file's bytes.  patch is passed
+// the file, the offset of the section's header, and the offset of
+// its data.
+template<typename Patch>
+static std::string
+decompress_patched(const char *path, const char *name, Patch patch)
+{
+        elf::elf orig = open_elf(path);
+        auto &hdr = orig.get_hdr();
+        size_t shdr_off = 0;
+        for (auto &sec : orig.sections()) {
+                if (sec.get_name() == name)
+                        break;
+                shdr_off++;
+        }
+        shdr_off = hdr.shoff + shdr_off * hdr.shentsize;
+
+        auto image = std::make_shared<std::vector<char> >();
+        int fd = open(path, O_RDONLY);
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0)
+                image->insert(image->end(), buf, buf + n);
+        close(fd);
+        patch(image->data(), shdr_off, orig.get_section(name).get_hdr().offset);
+
+        elf::elf f(elf::create_memory_loader(image->data(), image->size(),
+                                             image));
+        try {
+                f.get_section(name).uncompressed_data();
+        } catch (elf::format_error &e) {
+                return e.what();
+        }
+        return "";
+}
+
+// Headers that claim more than either algorithm can expand to, and
+// headers cut short
+static void
+test_compressed_section_errors()
+{
+        typedef elf::Shdr<elf::Elf64> Shdr;
+        typedef elf::Chdr<elf::Elf64> Chdr;
+        std::string err;
+
+        // Both test inputs are little-endian ELF64
+        err = decompress_patched("inputs/gz-zlib", ".debug_info",
+                                 [](char *f, size_t shdr, size_t data) {
+                uint64_t size = (uint64_t)1 << 40;
+                memcpy(f + data + offsetof(Chdr, size), &size, 8);
+        });
+        CHECK(err == "implausible uncompressed section size");
+        err = decompress_patched("inputs/gz-zdebug", ".zdebug_info",
+                                 [](char *f, size_t shdr, size_t data) {
+                // The size is big-endian
+                memset(f + data + 4, 0, 8);
+                f[data + 6] = 1;
+        });
+        CHECK(err == "implausible uncompressed section size");
+
+        err = decompress_patched("inputs/gz-zlib", ".debug_info",
+                                 [](char *f, size_t shdr, size_t data) {
+                uint64_t size = sizeof(Chdr) - 1;
+                memcpy(f + shdr + offsetof(Shdr, size), &size, 8);
+        });
+        CHECK(err == "compressed section too small");
+        err = decompress_patched("inputs/gz-zdebug", ".zdebug_info",
+                                 [](char *f, size_t shdr, size_t data) {
+                uint64_t size = 11;
+                memcpy(f + shdr + offsetof(Shdr, size), &size, 8);
+        });
+        CHECK(err == "bad .zdebug section header");
+
+        // A stream that ends before the size in the header
+        err = decompress_patched("inputs/gz-zlib", ".debug_info",
+                                 [](char *f, size_t shdr, size_t data) {
+                uint64_t size;
+                memcpy(&size, f + shdr + offsetof(Shdr, size), 8);
+                size -= 8;
+                memcpy(f + shdr + offsetof(Shdr, size), &size, 8);
+        });
+        CHECK(err == "malformed zlib-compressed section");
+}
+
+// A symbol from a golden dump-syms output
+struct golden_sym
+{
+        uint64_t value, size;
+        std::string type, binding, index, name;
+};
+
+static std::vector<golden_sym>
+read_golden_syms(const std::string &path)
+{
+        std::vector<golden_sym> syms;
+        FILE *fp = fopen(path.c_str(), "r");
+        if (!fp) {
+                perror(path.c_str());
+                exit(1);
+        }
+        char line[1024];
+        while (fgets(line, sizeof(line), fp)) {
+                unsigned long long value, size;
+                char type[16], binding[16], index[16];
+                int end = 0;
+                if (sscanf(line, " %*d: %llx %llu %15s %15s %15s %n",
+                           &value, &size, type, binding, index, &end) < 5)
+                        continue;
+                std::string name(line + end);
+                while (!name.empty() && (name.back() == '\n' ||
+                                         name.back() == ' '))
+                        name.pop_back();
+                syms.push_back({value, size, type, binding, index, name});
+        }
+        fclose(fp);
+        return syms;
+}
+
+static int
+binding_rank(const std::string &binding)
+{
+        return binding == "global" ? 0 : binding == "weak" ? 1 : 2;
+}
+
+// The index against each file's golden symbol dump: one entry per
+// set of aliases, named after the strongest binding, and finds that
+// agree with a linear search
+static void
+test_symbol_index()
+{
+        static const char *const files[][2] = {
+                {"golden-gcc-4.9.2/example", "golden-gcc-4.9.2/syms"},
+                {"golden-gcc-6.2.1-s390x/example", "golden-gcc-6.2.1-s390x/syms"},
+                {"golden-gcc-12.2.0/example", "golden-gcc-12.2.0/syms"},
+                {"inputs/aliases", "inputs/aliases.syms"},
+        };
+        for (auto &file : files) {
+                elf::elf f = open_elf(file[0]);
+                elf::symbol_index index(f);
+
+                // Aliases have the same value, size, and type
+                typedef std::tuple<uint64_t, uint64_t, std::string> key;
+                std::map<key, std::vector<golden_sym> > want;
+                for (auto &sym : read_golden_syms(file[1]))
+                        if ((sym.type == "func" || sym.type == "object") &&
+                            sym.index != "undef")
+                                want[key(sym.value, sym.size, sym.type)]
+                                        .push_back(sym);
+                CHECK(!want.empty());
+                CHECK(index.size() == want.size());
+
+                for (auto &e : index) {
+                        std::string type = e.type() == elf::stt::func ?
+                                "func" : "object";
+                        auto it = want.find(key(e.value, e.size, type));
+                        CHECK(it != want.end());
+                        if (it == want.end())
+                                continue;
+                        int best = 2;
+                        bool named = false;
+                        for (auto &sym : it->second)
+                                best = std::min(best, binding_rank(sym.binding));
+                        for (auto &sym : it->second)
+                                if (binding_rank(sym.binding) == best &&
+                                    sym.name == index.get_name(e))
+                                        named = true;
+                        CHECK(named);
+                        CHECK(binding_rank(to_string(e.binding())) == best);
+                }
+
+                // Every address in and around each symbol, looked up
+                // one at a time and in a batch
+                std::vector<elf::Elf64::Addr> addrs = {0, ~(elf::Elf64::Addr)0};
+                for (auto &w : want) {
+                        uint64_t value = std::get<0>(w.first);
+                        uint64_t size = std::get<1>(w.first);
+                        if (value)
+                                addrs.push_back(value - 1);
+                        for (uint64_t a = value; a <= value + size; a++)
+                                addrs.push_back(a);
+                }
+                std::sort(addrs.begin(), addrs.end());
+                std::vector<const elf::symbol_index::entry *> batch(addrs.size());
+                index.find(addrs.data(), addrs.size(), batch.data());
+                for (size_t i = 0; i < addrs.size(); i++) {
+                        auto a = addrs[i];
+                        auto *e = index.find(a);
+                        CHECK(batch[i] == e);
+                        // The symbol with the greatest value not
+                        // exceeding a, preferring the largest
+                        const key *best = nullptr;
+                        for (auto &w : want)
+                                if (std::get<0>(w.first) <= a)
+                                        best = &w.first;
+                        bool in = best &&
+                                (a - std::get<0>(*best) < std::get<1>(*best) ||
+                                 a == std::get<0>(*best));
+                        CHECK(in == !!e);
+                        if (in && e)
+                                CHECK(e->value == std::get<0>(*best) &&
+                                      e->size == std::get<1>(*best));
+                }
+
+                // Adding the same tables again adds only aliases
+                size_t size = index.size();
+                for (auto &sec : f.sections())
+                        if (sec.get_hdr().type == elf::sht::symtab ||
+                            sec.get_hdr().type == elf::sht::dynsym)
+                                index.add(sec.as_symtab());
+                CHECK(index.size() == size);
+        }
+}
+
+// Return whether view lies within the data of sec
+static bool
+points_into(std::string_view view, const elf::section &sec)
+{
+        const char *data = (const char*)sec.data();
+        return data && view.data() >= data &&
+                view.data() + view.size() < data + sec.size();
+}
+
+// The string_view accessors return views of the loaded string
+// tables, not copies
+static void
+test_string_views()
+{
+        for (const char *path : {"golden-gcc-4.9.2/example",
+                                 "golden-gcc-6.2.1-s390x/example"}) {
+                elf::elf f = open_elf(path);
+                auto &shstrtab = f.get_section(f.get_hdr().shstrndx);
+                for (auto &sec : f.sections()) {
+                        CHECK(sec.get_name_view() == sec.get_name());
+                        CHECK(points_into(sec.get_name_view(), shstrtab));
+                }
+
+                int syms = 0;
+                for (auto &sec : f.sections()) {
+                        if (sec.get_hdr().type != elf::sht::symtab &&
+                            sec.get_hdr().type != elf::sht::dynsym)
+                                continue;
+                        auto &strsec = f.get_section(sec.get_hdr().link);
+                        auto strs = strsec.as_strtab();
+                        for (auto sym : sec.as_symtab()) {
+                                auto view = sym.get_name_view();
+                                CHECK(view == sym.get_name());
+                                CHECK(points_into(view, strsec));
+                                auto name = sym.get_data().name;
+                                CHECK(strs.get_view(name) == strs.get(name));
+                                CHECK(strs.get_view(name).data() == view.data());
+                                syms++;
+                        }
+                }
+                CHECK(syms > 0);
+
+                elf::symbol_index index(f);
+                for (auto &e : index)
+                        CHECK(index.get_name_view(e) == index.get_name(e));
+        }
+}
+
+// Return the contents of the file at path
+static std::vector<char>
+read_file(const char *path)
+{
+        std::vector<char> image;
+        int fd = open(path, O_RDONLY);
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0)
+                image.insert(image.end(), buf, buf + n);
+        close(fd);
+        return image;
+}
+
+// Sections read through a pread loader match the mmap loader's, and
+// each range's buffer lives until every load of it is released
+static void
+test_pread_loader()
+{
+        const char *path = "golden-gcc-4.9.2/example";
+        elf::elf mapped = open_elf(path);
+        elf::elf f(elf::create_pread_loader(open(path, O_RDONLY)));
+        CHECK(f.sections().size() == mapped.sections().size());
+        for (auto &sec : f.sections()) {
+                auto &want = mapped.get_section(sec.get_name());
+                CHECK(sec.size() == want.size());
+                if (sec.get_hdr().type == elf::sht::nobits) {
+                        CHECK(!sec.data());
+                        continue;
+                }
+                CHECK(sec.data() && memcmp(sec.data(), want.data(),
+                                           want.size()) == 0);
+        }
+
+        std::vector<char> image = read_file(path);
+        auto l = elf::create_pread_loader(open(path, O_RDONLY));
+        auto &text = mapped.get_section(".text").get_hdr();
+        off_t off = text.offset;
+        size_t size = text.size;
+        auto matches = [&](const void *p) {
+                return memcmp(p, image.data() + off, size) == 0;
+        };
+
+        // Two loads of a range share its buffer
+        const void *p = l->load(off, size);
+        CHECK(matches(p));
+        CHECK(l->load(off, size) == p);
+        // A release with the wrong size or an unknown pointer is
+        // ignored, so the range is still loaded twice
+        l->release(p, size + 1);
+        l->release(image.data(), size);
+        l->release(p, size);
+        CHECK(matches(p));
+        CHECK(l->load(off, size) == p);
+        l->release(p, size);
+        CHECK(matches(p));
+        l->release(p, size);
+        // Released more often than loaded
+        l->release(p, size);
+        CHECK(matches(l->load(off, size)));
+
+        // Empty ranges still have distinct buffers
+        const void *e1 = l->load(0, 0), *e2 = l->load(1, 0);
+        CHECK(e1 && e2 && e1 != e2);
+        l->release(e1, 0);
+        l->release(e2, 0);
+
+        bool threw = false;
+        try {
+                l->load(image.size() - 4, 8);
+        } catch (std::range_error &e) {
+                threw = true;
+        }
+        CHECK(threw);
+        CHECK(matches(l->load(off, size)));
+}
+
+// A read that fails leaves nothing behind, so a later load of the
+// same range reads it again
+static void
+test_pread_loader_retry()
+{
+        char path[] = "/tmp/elf-test.XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+                perror("mkstemp");
+                exit(1);
+        }
+        unlink(path);
+        std::vector<char> data(8192, 'a');
+        CHECK(write(fd, data.data(), data.size()) == (ssize_t)data.size());
+        auto l = elf::create_pread_loader(dup(fd));
+
+        // Cut the file short after the loader found its size
+        CHECK(ftruncate(fd, 4096) == 0);
+        bool threw = false;
+        try {
+                l->load(4000, 1000);
+        } catch (std::range_error &e) {
+                threw = true;
+        }
+        CHECK(threw);
+
+        CHECK(pwrite(fd, data.data(), data.size(), 0) == (ssize_t)data.size());
+        const char *p = (const char*)l->load(4000, 1000);
+        CHECK(p && memcmp(p, data.data(), 1000) == 0);
+        close(fd);
+}
+
+// Loads from several threads of ranges that the worker pool is
+// still prefetching
+static void
+test_async_loader()
+{
+        const char *path = "golden-gcc-4.9.2/example";
+        std::vector<char> image = read_file(path);
+        auto l = elf::create_async_loader(open(path, O_RDONLY), 3);
+
+        // Overlapping ranges of many sizes, up to half the file
+        std::vector<std::pair<off_t, size_t> > ranges;
+        for (size_t i = 0; i < 200; i++) {
+                size_t size = (i * 97) % (image.size() / 2);
+                off_t off = (i * 131) % (image.size() - size);
+                ranges.emplace_back(off, size);
+        }
+        for (auto &r : ranges)
+                l->prefetch(r.first, r.second);
+        // Past the end of the file, which is ignored
+        l->prefetch(image.size(), 1);
+
+        std::atomic<int> good{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+                threads.emplace_back([&, t] {
+                        // Each thread starts at a different range
+                        for (size_t i = 0; i < ranges.size(); i++) {
+                                auto &r = ranges[(i + t * 50) % ranges.size()];
+                                auto *p = l->load(r.first, r.second);
+                                if (memcmp(p, image.data() + r.first,
+                                           r.second) == 0)
+                                        good++;
+                                l->release(p, r.second);
+                        }
+                });
+        for (auto &t : threads)
+                t.join();
+        CHECK(good == 4 * (int)ranges.size());
+
+        // Destroyed with prefetches still queued behind one worker
+        auto slow = elf::create_async_loader(open(path, O_RDONLY), 1);
+        for (auto &r : ranges)
+                slow->prefetch(r.first, r.second);
+        slow.reset();
+}
+
+// A prefetch that fails leaves the range for load to read and report
+static void
+test_async_loader_retry()
+{
+        char path[] = "/tmp/elf-test.XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+                perror("mkstemp");
+                exit(1);
+        }
+        unlink(path);
+        std::vector<char> data(8192, 'a');
+        CHECK(write(fd, data.data(), data.size()) == (ssize_t)data.size());
+        auto l = elf::create_async_loader(dup(fd), 2);
+        CHECK(ftruncate(fd, 4096) == 0);
+
+        // The load may wait for the failed prefetch or race it; either
+        // way it reads again and fails itself
+        l->prefetch(4000, 1000);
+        bool threw = false;
+        try {
+                l->load(4000, 1000);
+        } catch (std::range_error &e) {
+                threw = true;
+        }
+        CHECK(threw);
+
+        CHECK(pwrite(fd, data.data(), data.size(), 0) == (ssize_t)data.size());
+        l->prefetch(4000, 1000);
+        const char *p = (const char*)l->load(4000, 1000);
+        CHECK(p && memcmp(p, data.data(), 1000) == 0);
+        close(fd);
+}
+
+int
+main()
+{
+        test_no_section_headers();
+        test_crc32();
+        test_debuglink();
+        test_minidebuginfo();
+        test_debugdata_bomb();
+        test_compressed_sections();
+        test_compressed_section_errors();
+        test_lazy_range();
+        test_symtab_lookup();
+        test_symbol_index();
+        test_string_views();
+        test_pread_loader();
+        test_pread_loader_retry();
+        test_async_loader();
+        test_async_loader_retry();
+
+        printf("%s elf-test\n", failures ? "FAIL" : "PASS");
+        return failures ? 1 : 0;
+}
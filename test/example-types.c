@@ -0,0 +1,15 @@
+struct point
+{
+        int x, y;
+};
+
+int norm2(struct point p)
+{
+        return p.x * p.x + p.y * p.y;
+}
+
+int main(int argc, char **argv)
+{
+        struct point p = {3, 4};
+        return norm2(p);
+}
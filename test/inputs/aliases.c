@@ -0,0 +1,7 @@
+// Global symbols with weak aliases, for the symbol index
+
+int impl(void) { return 1; }
+int weak_impl(void) __attribute__((weak, alias("impl")));
+
+int data = 1;
+extern int weak_data __attribute__((weak, alias("data")));
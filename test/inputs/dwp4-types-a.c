@@ -0,0 +1,16 @@
+struct alpha
+{
+        int a;
+        short b;
+};
+
+union gamma
+{
+        char c;
+        long l;
+};
+
+int use(struct alpha *p, union gamma g)
+{
+        return p->a + p->b + g.c;
+}
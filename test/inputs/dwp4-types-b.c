@@ -0,0 +1,13 @@
+struct beta
+{
+        double d;
+        unsigned char tag;
+};
+
+enum delta { D0, D1 };
+
+int main(int argc, char **argv)
+{
+        struct beta b = {1.0, D1};
+        return (int)b.d + b.tag;
+}
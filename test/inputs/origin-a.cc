@@ -0,0 +1,14 @@
+#include "origin.h"
+
+int
+counter::bump(int by)
+{
+        n += by;
+        return n;
+}
+
+int
+counter::twice(int x)
+{
+        return x * 2;
+}
@@ -0,0 +1,9 @@
+#include "origin.h"
+
+static counter c;
+
+int
+main(int argc, char **argv)
+{
+        return c.bump(argc) + counter::twice(argc);
+}
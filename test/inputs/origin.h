@@ -0,0 +1,6 @@
+struct counter
+{
+        int n;
+        int bump(int by);
+        static int twice(int x);
+};
@@ -0,0 +1,8 @@
+void
+_start(void)
+{
+        __asm__ volatile("mov $0x1122334455667788, %rbx\n"
+                         "mov $0x0123456789abcdef, %r12\n"
+                         "mov $0, %rbp\n"
+                         "hlt");
+}
@@ -0,0 +1,122 @@
+// Test process_context against a forked, ptrace-stopped child.
+
+#include "dwarf++.hh"
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int failures;
+
+#define CHECK(cond)                                                     \
+        do {                                                            \
+                if (!(cond)) {                                          \
+                        printf("%s:%d: check failed: %s\n",             \
+                               __FILE__, __LINE__, #cond);              \
+                        failures++;                                     \
+                }                                                       \
+        } while (0)
+
+// Stop until the parent continues us
+static void
+stop()
+{
+        raise(SIGSTOP);
+}
+
+static bool
+wait_stopped(pid_t pid)
+{
+        int status;
+        return waitpid(pid, &status, 0) == pid && WIFSTOPPED(status);
+}
+
+int
+main()
+{
+        size_t page = sysconf(_SC_PAGESIZE);
+        // Four pages: two readable, one inaccessible, one readable
+        char *buf = (char*)mmap(nullptr, 4 * page, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buf == MAP_FAILED) {
+                perror("mmap");
+                return 1;
+        }
+        mprotect(buf + 2 * page, page, PROT_NONE);
+        memset(buf, 'p', 2 * page);
+        memset(buf + 3 * page, 'p', page);
+
+        pid_t pid = fork();
+        if (pid < 0) {
+                perror("fork");
+                return 1;
+        }
+        if (pid == 0) {
+                // Write values only the child has
+                ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+                memset(buf, 'c', 2 * page);
+                memset(buf + 3 * page, 'c', page);
+                stop();
+                buf[page] = 'd';
+                stop();
+                _exit(0);
+        }
+        if (!wait_stopped(pid)) {
+                printf("FAIL process-test: child did not stop\n");
+                return 1;
+        }
+
+        dwarf::process_context ctx(pid);
+        dwarf::taddr base = (dwarf::taddr)buf;
+
+        // A read spanning two pages
+        char got[16];
+        CHECK(ctx.read(base + page - 8, got, sizeof(got)));
+        CHECK(memcmp(got, "cccccccccccccccc", sizeof(got)) == 0);
+        CHECK(ctx.deref_size(base + page - 2, 4) == 0x63636363);
+
+        // Unreadable addresses
+        CHECK(!ctx.read(base + 2 * page, got, 1));
+        CHECK(!ctx.read(base + 2 * page - 1, got, 2));
+        bool threw = false;
+        try {
+                ctx.deref_size(base + 2 * page, 8);
+        } catch (dwarf::expr_error &e) {
+                threw = true;
+        }
+        CHECK(threw);
+
+        // Prefetching across the hole still lets later pages be read
+        ctx.invalidate();
+        ctx.prefetch(base, 4 * page);
+        CHECK(ctx.read(base + 3 * page, got, 1) && got[0] == 'c');
+
+        // Registers.  The stack pointer of a stopped process is never
+        // zero.
+#if defined(__x86_64__)
+        CHECK(ctx.reg(7) != 0);
+#elif defined(__aarch64__)
+        CHECK(ctx.reg(31) != 0);
+#endif
+
+        // Cached memory is stale until invalidate()
+        CHECK(ctx.deref_size(base + page, 1) == 'c');
+        ptrace(PTRACE_CONT, pid, nullptr, nullptr);
+        if (!wait_stopped(pid)) {
+                printf("FAIL process-test: child did not stop again\n");
+                return 1;
+        }
+        CHECK(ctx.deref_size(base + page, 1) == 'c');
+        ctx.invalidate();
+        CHECK(ctx.deref_size(base + page, 1) == 'd');
+
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+
+        printf("%s process-test\n", failures ? "FAIL" : "PASS");
+        return failures ? 1 : 0;
+}
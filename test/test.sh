@@ -6,10 +6,11 @@ die() {
 }
 
 (cd ../examples && make --quiet) || die "failed to build examples"
+make --quiet || die "failed to build tests"
 
 dumps="sections segments lines syms tree"
 binaries=example
-compilers="gcc-4.9.2 gcc-6.2.1-s390x"
+compilers="gcc-4.9.2 gcc-6.2.1-s390x gcc-12.2.0 gcc-12.2.0-split gcc-12.2.0-types gcc-12.2.0-types-dwarf4 gcc-12.2.0-dwp gcc-12.2.0-dwp-dwarf4"
 
 if [[ $1 == --make-golden ]]; then
     MODE=make-golden
@@ -63,6 +64,13 @@ for dump in $dumps; do
     done
 done
 
+# Tests that need more than a golden dump, such as a live process
+if [[ $MODE != make-golden ]]; then
+    for t in process-test elf-test dwarf-test; do
+        ./$t || FAILED=$((FAILED + 1))
+    done
+fi
+
 if [[ $FAILED != 0 ]]; then
     echo "$FAILED test(s) failed"
     exit 1